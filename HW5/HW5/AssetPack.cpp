@@ -0,0 +1,245 @@
+#include "AssetPack.h"
+#include "TextureCache.h"
+#include "Utility.h"
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <cctype>
+#include <sys/stat.h>
+
+#define LOG(argument) std::cout << argument << '\n'
+
+AssetPack g_asset_pack;
+AssetPack* AssetPack::s_pack = &g_asset_pack;
+
+/*
+* Maps a pack and checks its table of contents, leaving the pack closed if anything is off
+*
+* @param filepath, path to the pack
+*/
+bool AssetPack::open(const std::string& filepath)
+{
+    close();
+
+    struct stat pack_stat;
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (stat(filepath.c_str(), &pack_stat) != 0 || !file->open(filepath) || file->get_size() < sizeof(AssetPackHeader)) return false;
+
+    AssetPackHeader header;
+    memcpy(&header, file->get_data(), sizeof(header));
+    if (memcmp(header.magic, "HWPK", 4) != 0 || header.version != ASSET_PACK_VERSION ||
+        file->get_size() < sizeof(header) + (size_t)header.entry_count * sizeof(AssetPackEntry))
+    {
+        LOG("Asset pack " << filepath << " is not a version " << ASSET_PACK_VERSION << " pack, ignoring it.");
+        return false;
+    }
+
+    // the header is 16 bytes and the mapping is page aligned, so the entries can be read in place
+    const AssetPackEntry* entries = (const AssetPackEntry*)(file->get_data() + sizeof(header));
+    for (uint32_t i = 0; i < header.entry_count; i++)
+    {
+        if (entries[i].offset > file->get_size() || entries[i].size > file->get_size() - entries[i].offset)
+        {
+            LOG("Asset pack " << filepath << " is truncated, ignoring it.");
+            return false;
+        }
+    }
+
+    m_file = file;
+    m_entries = entries;
+    m_entry_count = (int)header.entry_count;
+    m_mtime = (int64_t)pack_stat.st_mtime;
+
+    return true;
+}
+
+void AssetPack::close()
+{
+    m_file.reset();
+    m_entries = NULL;
+    m_entry_count = 0;
+    m_mtime = 0;
+}
+
+/*
+* Asset names are looked up the way Windows opens files -- case doesn't matter and
+* either slash works -- so "Font.png" and "font.png" are the same asset
+*
+* @param name, path of the asset, relative to the game's directory
+*/
+uint64_t AssetPack::hash_name(const std::string& name)
+{
+    std::string normalised = name;
+    for (char& character : normalised)
+    {
+        character = (char)tolower((unsigned char)character);
+        if (character == '\\') character = '/';
+    }
+
+    return Utility::hash((const unsigned char*)normalised.data(), normalised.size());
+}
+
+/*
+* Binary search of the table of contents -- safe from any thread once the pack is open
+*
+* @param name, path the asset was packed under
+* @return the entry, or NULL if the pack doesn't have it (or isn't open)
+*/
+const AssetPackEntry* AssetPack::find(const std::string& name) const
+{
+    if (m_entries == NULL) return NULL;
+
+    uint64_t hash = hash_name(name);
+    const AssetPackEntry* end = m_entries + m_entry_count;
+    const AssetPackEntry* entry = std::lower_bound(m_entries, end, hash,
+        [](const AssetPackEntry& entry, uint64_t hash) { return entry.hash < hash; });
+
+    return entry != end && entry->hash == hash ? entry : NULL;
+}
+
+/*
+* Whether the loose file an asset was packed from has changed since the pack was built
+* Only the loaders' lookups check this, since it costs a stat
+*
+* @param name, path the asset was packed under
+*/
+bool AssetPack::is_stale(const std::string& name) const
+{
+    struct stat loose;
+    return stat(name.c_str(), &loose) == 0 && (int64_t)loose.st_mtime > m_mtime;
+}
+
+/*
+* @param name, path the asset was packed under
+* @param type, what the asset has to be
+* @param data, size, set to the asset's bytes inside the mapping
+* @return false if the pack has no such asset, or its loose file is newer than the pack
+*/
+bool AssetPack::find(const std::string& name, AssetType type, const unsigned char** data, size_t* size) const
+{
+    const AssetPackEntry* entry = find(name);
+    if (entry == NULL || entry->type != (uint32_t)type) return false;
+    if (is_stale(name))
+    {
+        LOG(name << " is newer than the asset pack, reading it loose.");
+        return false;
+    }
+
+    *data = m_file->get_data() + entry->offset;
+    *size = (size_t)entry->size;
+
+    return true;
+}
+
+static AssetType get_asset_type(const std::string& name)
+{
+    size_t dot = name.find_last_of('.');
+    std::string extension = dot == std::string::npos ? "" : name.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+
+    if (extension == "png")  return ASSET_IMAGE;
+    if (extension == "glsl") return ASSET_SHADER;
+    if (extension == "wav" || extension == "mp3" || extension == "ogg") return ASSET_AUDIO;
+    return ASSET_RAW;
+}
+
+/*
+* Writes a pack of the given files, each stored under the name it was given by
+* Images are decoded here, so the game never runs a PNG decoder for them
+* A file that can't be read fails the build, so a pack never quietly lacks what it was asked for
+*
+* @param filepath, where the pack goes
+* @param names, paths of the files to pack, relative to the game's directory
+* @return false if the pack couldn't be written
+*/
+bool AssetPack::build(const std::string& filepath, const std::vector<std::string>& names)
+{
+    std::vector<AssetPackEntry> entries;
+    std::vector<std::vector<unsigned char>> payloads;
+
+    for (const std::string& name : names)
+    {
+        AssetPackEntry entry = {};
+        entry.hash = hash_name(name);
+        entry.type = (uint32_t)get_asset_type(name);
+
+        std::vector<unsigned char> payload;
+        if (entry.type == ASSET_IMAGE)
+        {
+            DecodedImage image = TextureCache::decode_png(name);
+            if (image.width == 0)
+            {
+                LOG("Unable to decode " << name << ", no pack written.");
+                return false;
+            }
+
+            AssetImageHeader image_header = { (uint32_t)image.width, (uint32_t)image.height };
+            payload.resize(sizeof(image_header) + image.get_byte_count());
+            memcpy(payload.data(), &image_header, sizeof(image_header));
+            memcpy(payload.data() + sizeof(image_header), image.get_pixels(), image.get_byte_count());
+        }
+        else
+        {
+            std::ifstream file(name, std::ios::binary);
+            if (file.fail())
+            {
+                LOG("Unable to read " << name << ", no pack written.");
+                return false;
+            }
+            payload.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+        bool is_duplicate = false;
+        for (const AssetPackEntry& other : entries) is_duplicate = is_duplicate || other.hash == entry.hash;
+        if (is_duplicate)
+        {
+            LOG("Skipping " << name << ", the pack already has a file by that name.");
+            continue;
+        }
+
+        entry.size = payload.size();
+        entries.push_back(entry);
+        payloads.push_back(std::move(payload));
+    }
+
+    // lay the payloads out in the order given, then sort the table for lookups
+    uint64_t offset = sizeof(AssetPackHeader) + entries.size() * sizeof(AssetPackEntry);
+    for (AssetPackEntry& entry : entries)
+    {
+        offset = (offset + ASSET_PACK_ALIGNMENT - 1) / ASSET_PACK_ALIGNMENT * ASSET_PACK_ALIGNMENT;
+        entry.offset = offset;
+        offset += entry.size;
+    }
+
+    std::vector<AssetPackEntry> sorted_entries = entries;
+    std::sort(sorted_entries.begin(), sorted_entries.end(),
+        [](const AssetPackEntry& a, const AssetPackEntry& b) { return a.hash < b.hash; });
+
+    AssetPackHeader header = {};
+    memcpy(header.magic, "HWPK", 4);
+    header.version = ASSET_PACK_VERSION;
+    header.entry_count = (uint32_t)entries.size();
+
+    std::ofstream file(filepath, std::ios::binary);
+    if (file.fail())
+    {
+        LOG("Unable to write " << filepath << ".");
+        return false;
+    }
+
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)sorted_entries.data(), sorted_entries.size() * sizeof(AssetPackEntry));
+
+    uint64_t written = sizeof(header) + sorted_entries.size() * sizeof(AssetPackEntry);
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        std::vector<char> padding((size_t)(entries[i].offset - written), 0);
+        file.write(padding.data(), padding.size());
+        file.write((const char*)payloads[i].data(), payloads[i].size());
+        written = entries[i].offset + entries[i].size;
+    }
+
+    return !file.fail();
+}
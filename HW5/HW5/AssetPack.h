@@ -0,0 +1,78 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include "MappedFile.h"
+
+#define ASSET_PACK_FILEPATH  "assets.pack"
+#define ASSET_PACK_VERSION   1
+#define ASSET_PACK_ALIGNMENT 4096 // every payload starts on a page
+
+enum AssetType { ASSET_RAW, ASSET_IMAGE, ASSET_SHADER, ASSET_AUDIO };
+
+// start of the pack, followed by entry_count AssetPackEntries sorted by hash
+struct AssetPackHeader
+{
+    char     magic[4]; // "HWPK"
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t reserved;
+};
+
+struct AssetPackEntry
+{
+    uint64_t hash;   // Utility::hash of the asset's name, see AssetPack::hash_name
+    uint64_t offset; // from the start of the pack, a multiple of ASSET_PACK_ALIGNMENT
+    uint64_t size;
+    uint32_t type;   // AssetType
+    uint32_t reserved;
+};
+
+// an ASSET_IMAGE payload is this, then width * height RGBA pixels
+struct AssetImageHeader
+{
+    uint32_t width;
+    uint32_t height;
+};
+
+/*
+* Every asset in one file, mapped once and read in place
+*
+* Images are stored already decoded, so their pixels go from the mapping to
+* glTexImage2D untouched. Shaders and audio are stored as the files they came from.
+* Without a pack (or for anything not in it) the loaders read loose files as before,
+* and a loose file changed after the pack was built is read instead of the pack's copy.
+*
+* Packs are made with HW5 --build-pack.
+*/
+class AssetPack
+{
+private:
+    static AssetPack* s_pack;
+
+    std::shared_ptr<MappedFile> m_file;
+    const AssetPackEntry* m_entries = NULL;
+    int m_entry_count = 0;
+    int64_t m_mtime = 0; // of the pack file, to spot loose files changed since
+
+public:
+    bool open(const std::string& filepath);
+    void close();
+
+    const AssetPackEntry* find(const std::string& name) const;
+    bool is_stale(const std::string& name) const;
+    bool find(const std::string& name, AssetType type, const unsigned char** data, size_t* size) const;
+
+    static uint64_t hash_name(const std::string& name);
+    static bool build(const std::string& filepath, const std::vector<std::string>& names);
+
+    bool                        const is_open()         const { return m_entries != NULL; }
+    int                         const get_entry_count() const { return m_entry_count; }
+    std::shared_ptr<MappedFile> const get_file()        const { return m_file; }
+
+    static AssetPack* get() { return s_pack; }
+    static void set(AssetPack* pack) { s_pack = pack; }
+};
+
+extern AssetPack g_asset_pack;
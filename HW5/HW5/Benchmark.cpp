@@ -0,0 +1,194 @@
+#define LOG(argument) std::cout << argument << '\n'
+
+#include "Benchmark.h"
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+bool   RenderTimer::s_enabled = false;
+double RenderTimer::s_seconds[RENDER_CATEGORY_COUNT] = { 0.0 };
+
+GLuint Benchmark::s_framebuffer = 0;
+GLuint Benchmark::s_colour_buffer = 0;
+
+RenderTimer::RenderTimer(RenderCategory category)
+{
+    m_category = category;
+    if (s_enabled) m_start = std::chrono::steady_clock::now();
+}
+
+RenderTimer::~RenderTimer()
+{
+    if (!s_enabled) return;
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_start;
+    s_seconds[m_category] += elapsed.count();
+}
+
+/*
+* Creates a surfaceless EGL context and makes a framebuffer object the
+* render target, so the game can render without a window or a GPU
+*
+* @param width, height, size of the framebuffer in pixels
+* @return true if the context and framebuffer were created
+*/
+bool Benchmark::create_offscreen_context(int width, int height)
+{
+#ifdef __linux__
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display == NULL)
+    {
+        LOG("EGL_EXT_platform_base is not supported.");
+        return false;
+    }
+
+    EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    EGLint major_version, minor_version;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major_version, &minor_version))
+    {
+        LOG("Unable to open a surfaceless EGL display.");
+        return false;
+    }
+
+    // legacy desktop GL, the same kind of context SDL gives the game
+    eglBindAPI(EGL_OPENGL_API);
+    EGLint context_attributes[] = { EGL_NONE };
+    EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, context_attributes);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+    {
+        LOG("Unable to create an EGL context.");
+        return false;
+    }
+
+    LOG("Renderer: " << glGetString(GL_RENDERER));
+
+    glGenFramebuffers(1, &s_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, s_framebuffer);
+
+    glGenRenderbuffers(1, &s_colour_buffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, s_colour_buffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, s_colour_buffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        LOG("Offscreen framebuffer is incomplete.");
+        return false;
+    }
+
+    return true;
+#else
+    LOG("Offscreen rendering is only supported on Linux.");
+    return false;
+#endif
+}
+
+/*
+* Reads back the framebuffer as RGBA, bottom row first
+*
+* @param width, height, size of the framebuffer in pixels
+* @param pixels, filled with width * height * 4 bytes
+*/
+void Benchmark::read_pixels(int width, int height, std::vector<unsigned char>& pixels)
+{
+    pixels.resize(width * height * 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+}
+
+/*
+* Writes the current framebuffer to a PNG
+* Pixels are stored uncompressed (deflate "stored" blocks), which keeps the
+* writer small and is fine for golden image comparisons
+*
+* @param filepath, where to write the image
+* @param width, height, size of the framebuffer in pixels
+*/
+void Benchmark::save_png(const char* filepath, int width, int height)
+{
+    std::vector<unsigned char> pixels;
+    read_pixels(width, height, pixels);
+
+    // PNG rows go top to bottom, GL rows bottom to top -- each row starts with filter type 0
+    std::vector<unsigned char> raw;
+    for (int row = height - 1; row >= 0; row--)
+    {
+        raw.push_back(0);
+        raw.insert(raw.end(), pixels.begin() + row * width * 4, pixels.begin() + (row + 1) * width * 4);
+    }
+
+    // zlib stream of stored blocks of at most 65535 bytes
+    std::vector<unsigned char> zlib = { 0x78, 0x01 };
+    unsigned int adler_a = 1, adler_b = 0;
+    for (size_t offset = 0; offset < raw.size(); offset += 65535)
+    {
+        unsigned int block_size = (unsigned int)std::min(raw.size() - offset, (size_t)65535);
+        bool is_last = offset + block_size == raw.size();
+
+        zlib.insert(zlib.end(), {
+            (unsigned char)(is_last ? 1 : 0),
+            (unsigned char)(block_size & 0xFF), (unsigned char)(block_size >> 8),
+            (unsigned char)(~block_size & 0xFF), (unsigned char)((~block_size >> 8) & 0xFF)
+            });
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + block_size);
+
+        for (size_t i = offset; i < offset + block_size; i++)
+        {
+            adler_a = (adler_a + raw[i]) % 65521;
+            adler_b = (adler_b + adler_a) % 65521;
+        }
+    }
+    unsigned int adler = (adler_b << 16) | adler_a;
+    zlib.insert(zlib.end(), { (unsigned char)(adler >> 24), (unsigned char)(adler >> 16), (unsigned char)(adler >> 8), (unsigned char)adler });
+
+    unsigned int crc_table[256];
+    for (unsigned int n = 0; n < 256; n++)
+    {
+        unsigned int c = n;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+        crc_table[n] = c;
+    }
+
+    FILE* file = fopen(filepath, "wb");
+    if (file == NULL)
+    {
+        LOG("Unable to write " << filepath);
+        return;
+    }
+
+    // chunk = length, type, data, crc of type and data
+    auto write_chunk = [&](const char* type, const std::vector<unsigned char>& data)
+    {
+        unsigned int length = (unsigned int)data.size();
+        unsigned char length_bytes[4] = { (unsigned char)(length >> 24), (unsigned char)(length >> 16), (unsigned char)(length >> 8), (unsigned char)length };
+        fwrite(length_bytes, 1, 4, file);
+        fwrite(type, 1, 4, file);
+        if (length > 0) fwrite(data.data(), 1, length, file);
+
+        unsigned int crc = 0xFFFFFFFF;
+        for (int i = 0; i < 4; i++) crc = crc_table[(crc ^ (unsigned char)type[i]) & 0xFF] ^ (crc >> 8);
+        for (unsigned int i = 0; i < length; i++) crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        crc ^= 0xFFFFFFFF;
+        unsigned char crc_bytes[4] = { (unsigned char)(crc >> 24), (unsigned char)(crc >> 16), (unsigned char)(crc >> 8), (unsigned char)crc };
+        fwrite(crc_bytes, 1, 4, file);
+    };
+
+    const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    fwrite(signature, 1, 8, file);
+
+    // 8 bit RGBA, no interlacing
+    write_chunk("IHDR", {
+        (unsigned char)(width >> 24), (unsigned char)(width >> 16), (unsigned char)(width >> 8), (unsigned char)width,
+        (unsigned char)(height >> 24), (unsigned char)(height >> 16), (unsigned char)(height >> 8), (unsigned char)height,
+        8, 6, 0, 0, 0
+        });
+    write_chunk("IDAT", zlib);
+    write_chunk("IEND", {});
+
+    fclose(file);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+
+#define GL_GLEXT_PROTOTYPES 1
+#include <chrono>
+#include <vector>
+#include <SDL_opengl.h>
+
+enum RenderCategory { RENDER_MAP, RENDER_ENTITY, RENDER_TEXT, RENDER_PARTICLES, RENDER_LIGHTING, RENDER_CATEGORY_COUNT };
+
+// adds the CPU time spent in a render call to its category while benchmarking
+// put one at the top of a render function -- it stops when it goes out of scope
+class RenderTimer
+{
+private:
+    RenderCategory m_category;
+    std::chrono::steady_clock::time_point m_start;
+
+public:
+    static bool   s_enabled;
+    static double s_seconds[RENDER_CATEGORY_COUNT];
+
+    RenderTimer(RenderCategory category);
+    ~RenderTimer();
+};
+
+// headless rendering for profiling -- no window, draws into a framebuffer object
+// only available on Linux, through a surfaceless EGL context (works on Mesa llvmpipe)
+class Benchmark
+{
+private:
+    static GLuint s_framebuffer;
+    static GLuint s_colour_buffer;
+
+public:
+    static bool create_offscreen_context(int width, int height);
+    static void read_pixels(int width, int height, std::vector<unsigned char>& pixels);
+    static void save_png(const char* filepath, int width, int height);
+};
@@ -0,0 +1,285 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include "LevelFile.h"
+#include "Map.h"
+
+// an OccluderEdge as plain floats, which the compiler can fill in
+struct EmbeddedOccluder
+{
+    float start_x, start_y;
+    float end_x, end_y;
+};
+static_assert(sizeof(EmbeddedOccluder) == sizeof(OccluderEdge), "embedded occluders are read as OccluderEdges");
+
+/*
+* A level built into the game, for when its level file can't be loaded
+*
+* make_embedded_level() turns rows of tile ids into the tiles, the solidity
+* mask, the map bounds and the same chunk meshes and occluders the level
+* compiler bakes, at compile time, so the level costs nothing at load and
+* can't be malformed -- a row of the wrong length, the wrong number of rows
+* or a spawn outside the map doesn't compile. HW5 --check-levels checks it
+* still matches the scene's level file and the CSV that was compiled from.
+*
+*   constexpr EmbeddedLevelData<3, 2> LEVEL = make_embedded_level<3, 2>(1.0f, 3, 1,
+*       { 0, 0, 0 },
+*       { 1, 1, 1 });
+*   static_assert(LEVEL.contains(SPAWNS), "...");
+*   EmbeddedLevel fallback = LEVEL.get_level(SPAWNS);
+*   level.open("levels/level.lvl", &fallback);
+*/
+template <int WIDTH, int HEIGHT>
+struct EmbeddedLevelData
+{
+    static constexpr int SOLID_MASK_STRIDE = (WIDTH + 31) / 32; // uint32_ts per row, like Map's
+    static constexpr int CHUNK_COUNT_X = (WIDTH + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE;
+    static constexpr int CHUNK_COUNT_Y = (HEIGHT + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE;
+
+    // every quad covers a tile at least, and along a row or column of a chunk
+    // two runs of exposed sides always have a tile between them
+    static constexpr int MAX_VERTICES = WIDTH * HEIGHT * 4;
+    static constexpr int MAX_OCCLUDERS = 2 * WIDTH * HEIGHT + 2 * (HEIGHT * CHUNK_COUNT_X + WIDTH * CHUNK_COUNT_Y);
+
+    float tile_size = 1.0f;
+    int   tile_count_x = 0;
+    int   tile_count_y = 0;
+
+    unsigned int tiles[WIDTH * HEIGHT] = {};
+    uint32_t     solid_mask[SOLID_MASK_STRIDE * HEIGHT] = {};
+
+    // baked like a compiled level's -- offsets are bytes into vertices and occluders
+    LevelChunk       chunks[CHUNK_COUNT_X * CHUNK_COUNT_Y] = {};
+    TileVertex       vertices[MAX_VERTICES] = {};
+    EmbeddedOccluder occluders[MAX_OCCLUDERS] = {};
+    int vertex_count = 0;
+    int occluder_count = 0;
+
+    // the same as Map's bounds
+    float left_bound = 0.0f;
+    float right_bound = 0.0f;
+    float top_bound = 0.0f;
+    float bottom_bound = 0.0f;
+
+    constexpr bool contains(const LevelSpawn& spawn) const
+    {
+        return spawn.x >= left_bound && spawn.x <= right_bound && spawn.y <= top_bound && spawn.y >= bottom_bound;
+    }
+
+    template <size_t SPAWN_COUNT>
+    constexpr bool contains(const LevelSpawn (&spawns)[SPAWN_COUNT]) const
+    {
+        for (size_t i = 0; i < SPAWN_COUNT; i++)
+        {
+            if (!contains(spawns[i])) return false;
+        }
+        return true;
+    }
+
+    // what LevelFile::open() falls back on -- only valid for data with static storage, like a constexpr global
+    EmbeddedLevel get_level(const LevelSpawn* spawns, int spawn_count) const
+    {
+        return { WIDTH, HEIGHT, tile_size, tile_count_x, tile_count_y, tiles, solid_mask, spawns, spawn_count,
+            MAP_CHUNK_SIZE, chunks, (const unsigned char*)vertices, (const unsigned char*)occluders,
+            left_bound, right_bound, top_bound, bottom_bound };
+    }
+
+    // no defaults on the overload above, or an array of spawns would decay to it and lose its count
+    EmbeddedLevel get_level() const { return get_level(NULL, 0); }
+
+    template <size_t SPAWN_COUNT>
+    EmbeddedLevel get_level(const LevelSpawn (&spawns)[SPAWN_COUNT]) const { return get_level(spawns, (int)SPAWN_COUNT); }
+};
+
+constexpr bool are_rows(size_t) { return true; }
+
+// whether every length is width
+template <typename... LENGTHS>
+constexpr bool are_rows(size_t width, size_t length, LENGTHS... lengths)
+{
+    return length == width && are_rows(width, lengths...);
+}
+
+/*
+* Map::build_chunk at compile time -- greedy meshing of one chunk of an embedded level
+*
+* @param level, the level being laid out, with its tiles in
+* @param chunk_x, chunk_y, position of the chunk in the chunk grid
+*/
+template <int WIDTH, int HEIGHT>
+constexpr void bake_embedded_chunk_mesh(EmbeddedLevelData<WIDTH, HEIGHT>& level, int chunk_x, int chunk_y)
+{
+    int first_x = chunk_x * MAP_CHUNK_SIZE;
+    int first_y = chunk_y * MAP_CHUNK_SIZE;
+    int chunk_width = (first_x + MAP_CHUNK_SIZE < WIDTH ? first_x + MAP_CHUNK_SIZE : WIDTH) - first_x;
+    int chunk_height = (first_y + MAP_CHUNK_SIZE < HEIGHT ? first_y + MAP_CHUNK_SIZE : HEIGHT) - first_y;
+
+    // ids past the end of the tile set wrap around, like they do in Map
+    int layer_count = level.tile_count_x * level.tile_count_y;
+    int layers[MAP_CHUNK_SIZE][MAP_CHUNK_SIZE] = {};
+    bool has_tile[MAP_CHUNK_SIZE][MAP_CHUNK_SIZE] = {};
+    for (int y = 0; y < chunk_height; y++)
+    {
+        for (int x = 0; x < chunk_width; x++)
+        {
+            unsigned int tile = level.tiles[(first_y + y) * WIDTH + first_x + x];
+            has_tile[y][x] = tile != 0;
+            layers[y][x] = (int)(tile % layer_count);
+        }
+    }
+
+    LevelChunk& chunk = level.chunks[chunk_y * level.CHUNK_COUNT_X + chunk_x];
+    chunk.vertex_offset = (uint32_t)(level.vertex_count * sizeof(TileVertex));
+    for (int y = 0; y < chunk_height; y++)
+    {
+        for (int x = 0; x < chunk_width; x++)
+        {
+            if (!has_tile[y][x]) continue;
+            int layer = layers[y][x];
+
+            int run_width = 1;
+            while (x + run_width < chunk_width && has_tile[y][x + run_width] && layers[y][x + run_width] == layer) run_width++;
+
+            int run_height = 1;
+            while (y + run_height < chunk_height)
+            {
+                bool row_matches = true;
+                for (int i = 0; i < run_width && row_matches; i++)
+                {
+                    row_matches = has_tile[y + run_height][x + i] && layers[y + run_height][x + i] == layer;
+                }
+                if (!row_matches) break;
+                run_height++;
+            }
+
+            for (int j = 0; j < run_height; j++)
+            {
+                for (int i = 0; i < run_width; i++) has_tile[y + j][x + i] = false;
+            }
+
+            // top left, bottom left, bottom right, top right -- baked meshes have no animation
+            GLshort left = (GLshort)x;
+            GLshort right = (GLshort)(x + run_width);
+            GLshort top = (GLshort)-y;
+            GLshort bottom = (GLshort)-(y + run_height);
+            level.vertices[level.vertex_count++] = TileVertex{ left,  top,    (GLshort)layer, 0, 0 };
+            level.vertices[level.vertex_count++] = TileVertex{ left,  bottom, (GLshort)layer, 0, 0 };
+            level.vertices[level.vertex_count++] = TileVertex{ right, bottom, (GLshort)layer, 0, 0 };
+            level.vertices[level.vertex_count++] = TileVertex{ right, top,    (GLshort)layer, 0, 0 };
+        }
+    }
+    chunk.vertex_count = (uint32_t)(level.vertex_count - chunk.vertex_offset / sizeof(TileVertex));
+}
+
+// a tile of an embedded level, with the outside counting as empty like Map::has_tile
+template <int WIDTH, int HEIGHT>
+constexpr bool has_embedded_tile(const EmbeddedLevelData<WIDTH, HEIGHT>& level, int x, int y)
+{
+    return x >= 0 && x < WIDTH && y >= 0 && y < HEIGHT && level.tiles[y * WIDTH + x] != 0;
+}
+
+/*
+* Map::build_occluders at compile time -- the merged sides of one chunk's tiles that face an empty tile
+*
+* @param level, the level being laid out, with its tiles in
+* @param chunk_x, chunk_y, position of the chunk in the chunk grid
+*/
+template <int WIDTH, int HEIGHT>
+constexpr void bake_embedded_chunk_occluders(EmbeddedLevelData<WIDTH, HEIGHT>& level, int chunk_x, int chunk_y)
+{
+    int first_x = chunk_x * MAP_CHUNK_SIZE;
+    int first_y = chunk_y * MAP_CHUNK_SIZE;
+    int last_x = first_x + MAP_CHUNK_SIZE < WIDTH ? first_x + MAP_CHUNK_SIZE : WIDTH;
+    int last_y = first_y + MAP_CHUNK_SIZE < HEIGHT ? first_y + MAP_CHUNK_SIZE : HEIGHT;
+    float tile_size = level.tile_size;
+    float half_tile = tile_size / 2;
+
+    LevelChunk& chunk = level.chunks[chunk_y * level.CHUNK_COUNT_X + chunk_x];
+    chunk.occluder_offset = (uint32_t)(level.occluder_count * sizeof(EmbeddedOccluder));
+
+    // tops and bottoms, merged along each row
+    for (int y = first_y; y < last_y; y++)
+    {
+        for (int side = -1; side <= 1; side += 2)
+        {
+            float edge_y = -(y * tile_size) - (side * half_tile);
+            int run_start = -1;
+            for (int x = first_x; x <= last_x; x++)
+            {
+                bool is_exposed = x < last_x && has_embedded_tile(level, x, y) && !has_embedded_tile(level, x, y + side);
+                if (is_exposed && run_start < 0) run_start = x;
+                if (is_exposed || run_start < 0) continue;
+
+                level.occluders[level.occluder_count++] = EmbeddedOccluder{ run_start * tile_size - half_tile, edge_y, x * tile_size - half_tile, edge_y };
+                run_start = -1;
+            }
+        }
+    }
+
+    // left and right sides, merged down each column
+    for (int x = first_x; x < last_x; x++)
+    {
+        for (int side = -1; side <= 1; side += 2)
+        {
+            float edge_x = (x * tile_size) + (side * half_tile);
+            int run_start = -1;
+            for (int y = first_y; y <= last_y; y++)
+            {
+                bool is_exposed = y < last_y && has_embedded_tile(level, x, y) && !has_embedded_tile(level, x + side, y);
+                if (is_exposed && run_start < 0) run_start = y;
+                if (is_exposed || run_start < 0) continue;
+
+                level.occluders[level.occluder_count++] = EmbeddedOccluder{ edge_x, -(run_start * tile_size) + half_tile, edge_x, -(y * tile_size) + half_tile };
+                run_start = -1;
+            }
+        }
+    }
+    chunk.occluder_count = (uint32_t)(level.occluder_count - chunk.occluder_offset / sizeof(EmbeddedOccluder));
+}
+
+/*
+* Lays out a level at compile time
+*
+* @param tile_size, world units per tile
+* @param tile_count_x, tile_count_y, tiles across and down the tile set
+* @param rows, HEIGHT rows of WIDTH tile ids each, top to bottom -- 0 is empty
+*/
+template <int WIDTH, int HEIGHT, size_t... LENGTHS>
+constexpr EmbeddedLevelData<WIDTH, HEIGHT> make_embedded_level(float tile_size, int tile_count_x, int tile_count_y,
+    const unsigned int (&... rows)[LENGTHS])
+{
+    static_assert(sizeof...(LENGTHS) == HEIGHT, "an embedded level needs HEIGHT rows");
+    static_assert(are_rows(WIDTH, LENGTHS...), "every row of an embedded level has to be WIDTH tiles long");
+
+    EmbeddedLevelData<WIDTH, HEIGHT> level;
+    level.tile_size = tile_size;
+    level.tile_count_x = tile_count_x;
+    level.tile_count_y = tile_count_y;
+
+    const unsigned int* row_tiles[] = { rows... };
+    for (int y = 0; y < HEIGHT; y++)
+    {
+        for (int x = 0; x < WIDTH; x++)
+        {
+            unsigned int tile = row_tiles[y][x];
+            level.tiles[y * WIDTH + x] = tile;
+            if (tile != 0) level.solid_mask[y * level.SOLID_MASK_STRIDE + (x >> 5)] |= 1u << (x & 31);
+        }
+    }
+
+    for (int chunk_y = 0; chunk_y < level.CHUNK_COUNT_Y; chunk_y++)
+    {
+        for (int chunk_x = 0; chunk_x < level.CHUNK_COUNT_X; chunk_x++)
+        {
+            bake_embedded_chunk_mesh(level, chunk_x, chunk_y);
+            bake_embedded_chunk_occluders(level, chunk_x, chunk_y);
+        }
+    }
+
+    level.left_bound = 0 - (tile_size / 2);
+    level.right_bound = (tile_size * WIDTH) - (tile_size / 2);
+    level.top_bound = 0 + (tile_size / 2);
+    level.bottom_bound = -(tile_size * HEIGHT) + (tile_size / 2);
+
+    return level;
+}
@@ -13,16 +13,29 @@
 #include "glm/gtc/matrix_transform.hpp"
 #include "ShaderProgram.h"
 #include "Entity.h"
+#include "Utility.h"
+#include "Benchmark.h"
+#include "RenderBackend.h"
+#include "ParticleSystem.h"
+#include <type_traits>
 
 
+// spawning copies whole entities, so they have to stay plain data
+static_assert(std::is_trivially_copyable<Entity>::value, "Entity is copied to spawn more of the same kind");
+
 /*
-    The ENTITY Class's Default constructor
+    The ENTITY Class's constructor
+    Everything the kind of entity decides comes from its archetype
+
+    @param archetype, which kind of entity
+    @param position, where it starts
 */
-Entity::Entity()
+Entity::Entity(EntityArchetypeId archetype, glm::vec3 position)
 {
+    m_archetype = archetype;
+
     // position and tranformation variables
-    m_position = glm::vec3(0.0f);
-    m_model_matrix = glm::mat4(1.0f);
+    m_position = position;
 
     // physics variables
     m_velocity = glm::vec3(0.0f);
@@ -46,8 +59,8 @@ void Entity::update(float delta_time, Entity* player, Entity* objects, int objec
 {
     // if not active -- then can't update, treat like deletion
     if (!m_is_active) return;
-    if (m_entity_type == CHAIN) chain_activate(player, delta_time);
-    if (m_entity_type == ENEMY) ai_activate(player, delta_time);
+    if (get_entity_type() == CHAIN) chain_activate(player, delta_time);
+    if (get_entity_type() == ENEMY) ai_activate(player, delta_time);
 
     // reset collision checks every frame
     // entity collision checks
@@ -59,10 +72,12 @@ void Entity::update(float delta_time, Entity* player, Entity* objects, int objec
     m_wallcheck_left = false;
     m_wallcheck_right = false;
 
-    m_velocity.x = m_movement.x * get_speed();
-    if ((m_entity_type == CHAIN) || (m_entity_type == PLAYER && chain_timer > 0.0f)) m_velocity.y = m_movement.y * get_speed();
+    // on the rope, input pushes the swing along instead of setting the speed
+    if (is_swinging) m_velocity.x += m_movement.x * get_speed() * delta_time;
+    else m_velocity.x = m_movement.x * get_speed();
+    if (get_entity_type() == CHAIN) m_velocity.y = m_movement.y * get_speed();
 
-    if (m_has_gravity) set_acceleration(glm::vec3(0.0f, -9.81f, 0.0f)); // gravity check
+    if (get_archetype().has_gravity) set_acceleration(glm::vec3(0.0f, -9.81f, 0.0f)); // gravity check
     m_velocity += get_acceleration() * delta_time; // velocity equation implemented in code
 
     // must be calculated seperatedly for seperate collisions
@@ -74,21 +89,19 @@ void Entity::update(float delta_time, Entity* player, Entity* objects, int objec
     check_collision_y(objects, object_count);
     check_collision_y(map);
 
-    // reset model before every change
-    m_model_matrix = glm::mat4(1.0f);
-    m_model_matrix = glm::translate(m_model_matrix, m_position);
-
     // jumping
     if (m_is_jumping)
     {
         m_is_jumping = false;
-        m_velocity.y += m_jumping_power;
+        m_velocity.y += get_jumping_power();
+        ParticleSystem::burst(m_position - glm::vec3(0.0f, get_height() / 2, 0.0f), 8, 1.5f, 0.3f);
     }
 
     if (m_is_wall_jumping)
     {
         m_is_wall_jumping = false;
-        m_velocity.y += m_jumping_power;
+        m_velocity.y += get_jumping_power();
+        ParticleSystem::burst(m_position, 8, 1.5f, 0.3f);
     }
 }
 
@@ -111,15 +124,19 @@ void const Entity::check_collision_y(Entity* collidable_entities, int collidable
 
         if (check_collision(collidable_entity))
         {
-            if (m_entity_type == DOOR && collidable_entity->m_entity_type == PLAYER) level_finished = true;
-            if (m_entity_type == CHAIN && collidable_entity->m_entity_type == ENEMY) collidable_entity->disable();
-            if (m_entity_type == ENEMY && collidable_entity->m_entity_type == PLAYER)
+            if (get_entity_type() == DOOR && collidable_entity->get_entity_type() == PLAYER) level_finished = true;
+            if (get_entity_type() == CHAIN && collidable_entity->get_entity_type() == ENEMY)
+            {
+                collidable_entity->disable();
+                ParticleSystem::burst(collidable_entity->get_position(), 24, 3.0f, 0.6f);
+            }
+            if (get_entity_type() == ENEMY && collidable_entity->get_entity_type() == PLAYER)
             {
                 std::cout << "RAH";
                 touching_player = true;
             }
             float y_distance = fabs(m_position.y - collidable_entity->get_position().y);
-            float y_overlap = fabs(y_distance - (m_height / 2.0f) - (collidable_entity->get_height() / 2.0f));
+            float y_overlap = fabs(y_distance - (get_height() / 2.0f) - (collidable_entity->get_height() / 2.0f));
             if (m_velocity.y > 0) {
                 m_position.y -= y_overlap;
                 m_velocity.y = 0;
@@ -142,14 +159,14 @@ void const Entity::check_collision_y(Entity* collidable_entities, int collidable
 void const Entity::check_collision_y(Map* map)
 {
     // Check all tiles above, including left and right for corner interaction
-    glm::vec3 top = glm::vec3(m_position.x, m_position.y + (m_height / 2), m_position.z);
-    glm::vec3 top_left = glm::vec3(m_position.x - (m_width / 2), m_position.y + (m_height / 2), m_position.z);
-    glm::vec3 top_right = glm::vec3(m_position.x + (m_width / 2), m_position.y + (m_height / 2), m_position.z);
+    glm::vec3 top = glm::vec3(m_position.x, m_position.y + (get_height() / 2), m_position.z);
+    glm::vec3 top_left = glm::vec3(m_position.x - (get_width() / 2), m_position.y + (get_height() / 2), m_position.z);
+    glm::vec3 top_right = glm::vec3(m_position.x + (get_width() / 2), m_position.y + (get_height() / 2), m_position.z);
 
     // Check all tiles belove, including left and right for corner interaction
-    glm::vec3 bottom = glm::vec3(m_position.x, m_position.y - (m_height / 2), m_position.z);
-    glm::vec3 bottom_left = glm::vec3(m_position.x - (m_width / 2), m_position.y - (m_height / 2), m_position.z);
-    glm::vec3 bottom_right = glm::vec3(m_position.x + (m_width / 2), m_position.y - (m_height / 2), m_position.z);
+    glm::vec3 bottom = glm::vec3(m_position.x, m_position.y - (get_height() / 2), m_position.z);
+    glm::vec3 bottom_left = glm::vec3(m_position.x - (get_width() / 2), m_position.y - (get_height() / 2), m_position.z);
+    glm::vec3 bottom_right = glm::vec3(m_position.x + (get_width() / 2), m_position.y - (get_height() / 2), m_position.z);
 
     float penetration_x = 0;
     float penetration_y = 0;
@@ -230,15 +247,19 @@ void const Entity::check_collision_x(Entity* collidable_entities, int collidable
 
         if (check_collision(collidable_entity))
         {
-            if (m_entity_type == DOOR && collidable_entity->m_entity_type == PLAYER) level_finished = true;
-            if (m_entity_type == CHAIN && collidable_entity->m_entity_type == ENEMY) collidable_entity->disable();
-            if (m_entity_type == ENEMY && collidable_entity->m_entity_type == PLAYER)
+            if (get_entity_type() == DOOR && collidable_entity->get_entity_type() == PLAYER) level_finished = true;
+            if (get_entity_type() == CHAIN && collidable_entity->get_entity_type() == ENEMY)
+            {
+                collidable_entity->disable();
+                ParticleSystem::burst(collidable_entity->get_position(), 24, 3.0f, 0.6f);
+            }
+            if (get_entity_type() == ENEMY && collidable_entity->get_entity_type() == PLAYER)
             {
                 std::cout << "RAH";
                 touching_player = true;
             }
             float x_distance = fabs(m_position.x - collidable_entity->get_position().x);
-            float x_overlap = fabs(x_distance - (m_width / 2.0f) - (collidable_entity->get_width() / 2.0f));
+            float x_overlap = fabs(x_distance - (get_width() / 2.0f) - (collidable_entity->get_width() / 2.0f));
             if (m_velocity.x > 0) {
                 m_position.x -= x_overlap;
                 m_velocity.x = 0;
@@ -261,12 +282,12 @@ void const Entity::check_collision_x(Entity* collidable_entities, int collidable
 void const Entity::check_collision_x(Map* map)
 {
     // Check if touching tile
-    glm::vec3 left = glm::vec3(m_position.x - (m_width / 2), m_position.y, m_position.z);
-    glm::vec3 right = glm::vec3(m_position.x + (m_width / 2), m_position.y, m_position.z);
+    glm::vec3 left = glm::vec3(m_position.x - (get_width() / 2), m_position.y, m_position.z);
+    glm::vec3 right = glm::vec3(m_position.x + (get_width() / 2), m_position.y, m_position.z);
 
     // Check if touching wall
-    glm::vec3 left_wall = left - glm::vec3(m_wallcheck_offset, 0.0f, 0.0f);
-    glm::vec3 right_wall = right + glm::vec3(m_wallcheck_offset, 0.0f, 0.0f);
+    glm::vec3 left_wall = left - glm::vec3(get_archetype().wallcheck_offset, 0.0f, 0.0f);
+    glm::vec3 right_wall = right + glm::vec3(get_archetype().wallcheck_offset, 0.0f, 0.0f);
 
     float penetration_x = 0;
     float penetration_y = 0;
@@ -296,25 +317,32 @@ void const Entity::check_collision_x(Map* map)
 */
 void Entity::render(ShaderProgram* program)
 {
-    program->set_model_matrix(m_model_matrix);
+    RenderTimer timer(RENDER_ENTITY);
 
     // if not active -- then can't render, treat like deletion
     if (!m_is_active || !m_is_rendered) { return; }
 
-    float vertices[] = { -0.5, -0.5, 0.5, -0.5, 0.5, 0.5, -0.5, -0.5, 0.5, 0.5, -0.5, 0.5 };
-    float tex_coords[] = { 0.0,  1.0, 1.0,  1.0, 1.0, 0.0,  0.0,  1.0, 1.0, 0.0,  0.0, 0.0 };
+    program->set_model_transform(Transform2D(glm::vec2(m_position)));
+
+    // interleaved position and uv -- one quad drawn with the shared quad indices
+    static const float vertices[] = {
+        -0.5, -0.5, 0.0, 1.0,
+         0.5, -0.5, 1.0, 1.0,
+         0.5,  0.5, 1.0, 0.0,
+        -0.5,  0.5, 0.0, 0.0
+    };
 
-    glBindTexture(GL_TEXTURE_2D, m_texture_id);
+    RenderBackend* backend = RenderBackend::get();
+    backend->set_layer(RENDER_LAYER_ENTITY);
+    backend->bind_texture(GL_TEXTURE_2D, get_texture_id(), 0);
 
-    glVertexAttribPointer(program->get_position_attribute(), 2, GL_FLOAT, false, 0, vertices);
-    glEnableVertexAttribArray(program->get_position_attribute());
-    glVertexAttribPointer(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 0, tex_coords);
-    glEnableVertexAttribArray(program->get_tex_coordinate_attribute());
+    backend->set_attribute(program->get_position_attribute(), 2, GL_FLOAT, false, 4 * sizeof(float), vertices);
+    backend->set_attribute(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 4 * sizeof(float), vertices + 2);
 
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    backend->draw_quads(1);
 
-    glDisableVertexAttribArray(program->get_position_attribute());
-    glDisableVertexAttribArray(program->get_tex_coordinate_attribute());
+    backend->disable_attribute(program->get_position_attribute());
+    backend->disable_attribute(program->get_tex_coordinate_attribute());
 }
 
 /*
@@ -330,8 +358,8 @@ bool const Entity::check_collision(Entity* other) const
     // If either entity is inactive, there shouldn't be any collision
     if (!m_is_active || !other->m_is_active) return false;
 
-    float x_distance = fabs(m_position.x - other->m_position.x) - ((m_width + other->m_width) / 2.0f);
-    float y_distance = fabs(m_position.y - other->m_position.y) - ((m_height + other->m_height) / 2.0f);
+    float x_distance = fabs(m_position.x - other->m_position.x) - ((get_width() + other->get_width()) / 2.0f);
+    float y_distance = fabs(m_position.y - other->m_position.y) - ((get_height() + other->get_height()) / 2.0f);
 
     return x_distance < 0.0f && y_distance < 0.0f;
 }
@@ -389,6 +417,7 @@ void Entity::chain_activate(Entity* player, float delta_time)
         {
             player->chain_timer = 1.0f;
             chain_state = STICK;
+            ParticleSystem::burst(m_position, 12, 2.0f, 0.4f);
         }
 
         chain_timer -= delta_time;
@@ -415,15 +444,6 @@ void Entity::chain_activate(Entity* player, float delta_time)
     }
 }
 
-void Entity::move_to_target(const glm::vec3& target_position)
-{
-    if (m_position == target_position) return;
-    if (target_position.x < m_position.x) move_left();
-    else if (target_position.x > m_position.x) move_right();
-    if (target_position.y < m_position.y) move_down();
-    else if (target_position.y > m_position.y) move_up();
-}
-
 // AI SCRIPTS HERE
 
 /*
@@ -436,7 +456,7 @@ void Entity::move_to_target(const glm::vec3& target_position)
 */
 void Entity::ai_activate(Entity* player, float delta_time)
 {
-    switch (m_ai_type)
+    switch (get_ai_type())
     {
     case PATROL:
         ai_patrol(player, delta_time);
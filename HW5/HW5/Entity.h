@@ -4,42 +4,31 @@ enum EntityType { PLAYER, CHAIN, DOOR, ENEMY };
 enum ChainState { LAUNCH, SEARCHING, STICK, RETRACT };
 enum ChainDirection { LEFT, RIGHT, UP, DOWN };
 enum AIState { IDLE, PATROLING, CHASING };
-enum AIType { PATROL };
+enum AIType { PATROL, NO_AI };
 
 #include "Map.h"
+#include "EntityArchetype.h"
 
 class Entity {
 private:
     // position and tranformation variables
-    glm::vec3 m_position;
-    glm::mat4 m_model_matrix;
+    glm::vec3 m_position; // the model transform is built from it at render time
 
     // physics variables
     glm::vec3 m_velocity;
     glm::vec3 m_acceleration;
     glm::vec3 m_movement;
 
-    // specific to different entity types
-    float m_width = 1.0f;
-    float m_height = 1.0f;
-    float m_speed = 0.0f;
-    float m_jumping_power = 0.0f;
+    // everything the entity's kind decides -- size, speed, texture and so on
+    EntityArchetypeId m_archetype;
 
     // ENEMY AI
-    AIType     m_ai_type;
-    AIState    m_ai_state;
-
-    EntityType m_entity_type; // type of entity - treat as NAME
+    AIState    m_ai_state = IDLE;
 
     bool m_is_active = true; // objects that are not active -- basically deleted
     bool m_is_rendered = true; // objects that are not rendered are still active
 
 public:
-    GLuint m_texture_id; // texture
-
-    // physics - gravity
-    bool m_has_gravity = false;
-
     // physics - collision for all directions
     bool m_collided_top = false;
     bool m_collided_bottom = false;
@@ -49,7 +38,6 @@ public:
     // physics - wall collision
     bool m_wallcheck_left = false;
     bool m_wallcheck_right = false;
-    float m_wallcheck_offset = 0.15f;
 
     bool is_facing_right = true;
     float ability_timer = 2.0f;
@@ -62,6 +50,7 @@ public:
     ChainDirection chain_direction = RIGHT;
     ChainState chain_state = LAUNCH;
     float chain_timer = 0.0f;
+    bool is_swinging = false; // hanging from the rope -- keeps its sideways velocity (see Rope)
 
     // door
     bool level_finished = false;
@@ -70,8 +59,7 @@ public:
     float guard_timer = 2.0f;
     bool touching_player = false;
 
-    // default constructor
-    Entity();
+    Entity(EntityArchetypeId archetype, glm::vec3 position = glm::vec3(0.0f));
 
     void update(float delta_time, Entity* player, Entity* objects, int object_count, Map* map);
     void render(ShaderProgram* program);
@@ -87,7 +75,6 @@ public:
     void deactivate() { m_is_active = false; };
 
     void chain_activate(Entity* player, float delta_time);
-    void move_to_target(const glm::vec3& target_position);
 
     // ai scripts
     void ai_activate(Entity* player, float delta_time);
@@ -100,30 +87,26 @@ public:
     void move_down() { m_movement.y = -1.0f; };
 
     // GETTERS
-    EntityType const get_entity_type()    const { return m_entity_type; };
+    const EntityArchetype& get_archetype() const { return g_entity_archetypes[m_archetype]; };
+    EntityType const get_entity_type()    const { return get_archetype().entity_type; };
     glm::vec3  const get_position()       const { return m_position; };
     glm::vec3  const get_movement()       const { return m_movement; };
     glm::vec3  const get_velocity()       const { return m_velocity; };
     glm::vec3  const get_acceleration()   const { return m_acceleration; };
-    float        const get_width()          const { return m_width; };
-    float        const get_height()         const { return m_height; };
-    float      const get_speed()          const { return m_speed; };
-    float      const get_jumping_power()  const { return m_jumping_power; };
+    float        const get_width()          const { return get_archetype().width; };
+    float        const get_height()         const { return get_archetype().height; };
+    float      const get_speed()          const { return get_archetype().speed; };
+    float      const get_jumping_power()  const { return get_archetype().jumping_power; };
     bool       const get_active_state()   const { return m_is_active; };
-    AIType     const get_ai_type()        const { return m_ai_type; };
+    AIType     const get_ai_type()        const { return get_archetype().ai_type; };
     AIState    const get_ai_state()       const { return m_ai_state; };
+    GLuint     const get_texture_id()     const { return get_archetype().texture_id; };
 
     // SETTLERS
-    void const set_entity_type(EntityType new_entity_type) { m_entity_type = new_entity_type; };
     void const set_position(glm::vec3 new_position) { m_position = new_position; };
     void const set_movement(glm::vec3 new_movement) { m_movement = new_movement; };
     void const set_velocity(glm::vec3 new_velocity) { m_velocity = new_velocity; };
     void const set_acceleration(glm::vec3 new_acceleration) { m_acceleration = new_acceleration; };
-    void const set_width(float new_width) { m_width = new_width; };
-    void const set_height(float new_height) { m_height = new_height; };
-    void const set_speed(float new_speed) { m_speed = new_speed; };
-    void const set_jumping_power(float new_jumping_power) { m_jumping_power = new_jumping_power; };
-    void const set_ai_type(AIType new_ai_type) { m_ai_type = new_ai_type; };
     void const set_ai_state(AIState new_state) { m_ai_state = new_state; };
 
     void const disable() { m_is_active = false; };
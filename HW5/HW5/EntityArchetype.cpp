@@ -0,0 +1,40 @@
+#include "Entity.h"
+#include "Utility.h"
+
+// indexed by EntityArchetypeId
+EntityArchetype g_entity_archetypes[ENTITY_ARCHETYPE_COUNT] = {
+    // type    ai      width  height speed  jump  wallcheck gravity texture
+    { PLAYER, NO_AI,  1.0f,  1.0f,  3.75f, 6.0f, 0.15f,    true,   "Player.png", 0 },
+    { CHAIN,  NO_AI,  1.0f,  1.0f,  3.75f, 0.0f, 0.15f,    false,  "Chain.png",  0 },
+    { DOOR,   NO_AI,  1.0f,  1.0f,  0.0f,  0.0f, 0.15f,    false,  "Door.png",   0 },
+    { ENEMY,  PATROL, 1.0f,  1.0f,  0.5f,  0.0f, 0.15f,    true,   "Enemy.png",  0 }
+};
+
+/*
+* @param entity_type, the EntityType wanted
+* @param ai_type, the AIType wanted, only looked at for enemies
+* @return the first archetype that matches, or the patrolling enemy if none does
+*/
+EntityArchetypeId find_entity_archetype(EntityType entity_type, AIType ai_type)
+{
+    for (int i = 0; i < ENTITY_ARCHETYPE_COUNT; i++)
+    {
+        const EntityArchetype& archetype = g_entity_archetypes[i];
+        if (archetype.entity_type == entity_type && (entity_type != ENEMY || archetype.ai_type == ai_type)) return (EntityArchetypeId)i;
+    }
+
+    return PATROL_ENEMY_ARCHETYPE;
+}
+
+/*
+* Starts loading every archetype's texture and keeps its GL name on the archetype,
+* so rendering an entity never looks a texture up -- scenes call it as they load,
+* so the images decode alongside the map's tile set
+*/
+void load_entity_textures()
+{
+    for (EntityArchetype& archetype : g_entity_archetypes)
+    {
+        if (archetype.texture_id == 0) archetype.texture_id = Utility::load_texture(archetype.texture_filepath);
+    }
+}
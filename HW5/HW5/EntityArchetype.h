@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+
+// included by Entity.h after the entity enums
+enum EntityArchetypeId : uint8_t { PLAYER_ARCHETYPE, CHAIN_ARCHETYPE, DOOR_ARCHETYPE, PATROL_ENEMY_ARCHETYPE, ENTITY_ARCHETYPE_COUNT };
+
+/*
+* What every entity of one kind shares -- never changes once its texture is loaded
+*
+* Entities only keep the id of their archetype and read these through it,
+* so an Entity is just its own state and spawning one is a plain copy.
+* The table is in EntityArchetype.cpp, the one place to tune a kind of entity.
+*/
+struct EntityArchetype
+{
+    EntityType  entity_type;
+    AIType      ai_type; // NO_AI for anything that isn't an enemy
+    float       width;
+    float       height;
+    float       speed;
+    float       jumping_power;
+    float       wallcheck_offset; // how far past its side a wall counts as touching
+    bool        has_gravity;
+    const char* texture_filepath;
+    GLuint      texture_id; // 0 until load_entity_textures()
+};
+
+extern EntityArchetype g_entity_archetypes[ENTITY_ARCHETYPE_COUNT];
+
+EntityArchetypeId find_entity_archetype(EntityType entity_type, AIType ai_type = PATROL);
+
+void load_entity_textures();
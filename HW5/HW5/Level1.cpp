@@ -1,29 +1,32 @@
 #include "Level1.h"
 #include "Utility.h"
-
-#define LEVEL_WIDTH 14
-#define LEVEL_HEIGHT 8
+#include "EmbeddedLevel.h"
 
 // texture filepaths
 // MAPS
-const char MAP_TILESET_FILEPATH[] = "Tileset.png",
-PLAYER_FILEPATH[] = "Player.png",
-CHAIN_FILEPATH[] = "Chain.png",
-DOOR_FILEPATH[] = "Door.png",
-ENEMY_FILEPATH[] = "Enemy.png",
-FONT_FILEPATH[] = "Font.png";
-
-unsigned int LEVEL1_DATA[] =
+const char MAP_TILESET_FILEPATH[] = "tileset.png",
+FONT_FILEPATH[] = "font.png";
+
+// tiles and spawns
+const char LEVEL_FILEPATH[] = "levels/level1.lvl";
+
+// built into the game too, in case the level file is missing
+constexpr EmbeddedLevelData<14, 8> LEVEL1_DATA = make_embedded_level<14, 8>(1.0f, 3, 1,
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+    { 2, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 },
+    { 2, 0, 0, 0, 0, 0, 0, 0, 3, 3, 3, 0, 0, 1 },
+    { 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 },
+    { 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 },
+    { 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 },
+    { 2, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 0, 1 });
+constexpr LevelSpawn LEVEL1_SPAWNS[] =
 {
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    2, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
-    2, 0, 0, 0, 0, 0, 0, 0, 3, 3, 3, 0, 0, 1,
-    2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
-    2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
-    2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
-    2, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 0, 1
+    { PLAYER, 0, 1.0f, -6.0f },
+    { DOOR, 0, 0.0f, -1.0f },
+    { ENEMY, PATROL, 1.0f, -1.0f }
 };
+static_assert(LEVEL1_DATA.contains(LEVEL1_SPAWNS), "spawns have to be inside the level");
 
 Level1::~Level1()
 {
@@ -35,60 +38,51 @@ Level1::~Level1()
     Mix_FreeMusic(m_state.bgm);
 }
 
+const char* Level1::get_level_filepath() const { return LEVEL_FILEPATH; }
+EmbeddedLevel Level1::get_embedded_level() const { return LEVEL1_DATA.get_level(LEVEL1_SPAWNS); }
+
 void Level1::initialise()
 {
 
+    LevelFile level;
+    EmbeddedLevel fallback = get_embedded_level();
+    open_level(level, get_level_filepath(), &fallback);
+
     GLuint map_texture_id = Utility::load_texture(MAP_TILESET_FILEPATH);
-    m_state.map = new Map(LEVEL_WIDTH, LEVEL_HEIGHT, LEVEL1_DATA, map_texture_id, 1.0f, 3, 1);
+    GLuint map_array_texture_id = Utility::load_texture_array(MAP_TILESET_FILEPATH, level.get_tile_count_x(), level.get_tile_count_y());
+    delete m_state.map;
+    m_state.map = new Map(level, map_texture_id, map_array_texture_id);
+    load_entity_textures();
 
     // PLAYER
-    m_state.player = new Entity();
-    m_state.player->set_entity_type(PLAYER);
-    m_state.player->set_position(glm::vec3(1.0f, -6.0f, 0.0f));
+    m_state.player = new Entity(PLAYER_ARCHETYPE, level.get_spawn_position(PLAYER));
     m_state.player->set_movement(glm::vec3(0.0f, 0.0f, 0.0f));
-    m_state.player->set_speed(3.75f);
-    m_state.player->set_jumping_power(6.0f);
-    m_state.player->m_has_gravity = true;
-    m_state.player->m_texture_id = Utility::load_texture(PLAYER_FILEPATH);
 
     // CHAIN
-    m_state.chain = new Entity();
-    m_state.chain->set_entity_type(CHAIN);
-    m_state.chain->set_speed(3.75f);
+    m_state.chain = new Entity(CHAIN_ARCHETYPE);
     m_state.chain->set_movement(glm::vec3(0.0f, 0.0f, 0.0f));
-    m_state.chain->m_has_gravity = false;
-    m_state.chain->m_texture_id = Utility::load_texture(CHAIN_FILEPATH);
     m_state.chain->disable();
 
     // DOOR
-    m_state.door = new Entity();
-    m_state.door->set_entity_type(DOOR);
-    m_state.door->set_position(glm::vec3(0.0f, -1.0f, 0.0f));
-    m_state.door->set_speed(0.0f);
-    m_state.door->m_has_gravity = false;
-    m_state.door->m_texture_id = Utility::load_texture(DOOR_FILEPATH);
+    m_state.door = new Entity(DOOR_ARCHETYPE, level.get_spawn_position(DOOR));
 
     // ENEMY
-    m_state.enemies = new Entity();
-    m_state.enemies->set_entity_type(ENEMY);
-    m_state.enemies->set_ai_type(PATROL);
+    const LevelSpawn* enemy_spawn = level.find_spawn(ENEMY);
+    EntityArchetypeId enemy_archetype = enemy_spawn != NULL ? find_entity_archetype(ENEMY, (AIType)enemy_spawn->ai_type) : PATROL_ENEMY_ARCHETYPE;
+    m_state.enemies = new Entity(enemy_archetype, level.get_spawn_position(ENEMY));
     m_state.enemies->set_ai_state(IDLE);
-    m_state.enemies->set_position(glm::vec3(1.0f, -1.0f, 0.0f));
-    m_state.enemies->set_speed(0.5f);
-    m_state.enemies->m_has_gravity = true;
-    m_state.enemies->m_texture_id = Utility::load_texture(ENEMY_FILEPATH);
 
     /*
      BGM and SFX*/
     
     Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 4096);
 
-    m_state.bgm = Mix_LoadMUS("crowd_hammer.mp3");
+    m_state.bgm = Utility::load_music("crowd_hammer.mp3");
     Mix_PlayMusic(m_state.bgm, -1);
     Mix_VolumeMusic(10.0f);
 
-    m_state.jump_sfx = Mix_LoadWAV("player_jump.wav");
-    m_state.chain_sfx = Mix_LoadWAV("chain_throw.wav");
+    m_state.jump_sfx = Utility::load_sound("player_jump.wav");
+    m_state.chain_sfx = Utility::load_sound("chain_throw.wav");
 }
 
 void Level1::update(float delta_time)
@@ -110,7 +104,7 @@ void Level1::render(ShaderProgram* program)
     Utility::draw_text(program, Utility::load_texture(FONT_FILEPATH), "press space on walls to walljump", 0.5f,
         -0.2f, glm::vec3(1.0f, -5.75f, 0.0f));
 
-    m_state.map->render(program);
+    m_state.map->render();
     m_state.player->render(program);
     m_state.chain->render(program);
     m_state.door->render(program);
@@ -12,4 +12,6 @@ public:
     void initialise() override;
     void update(float delta_time) override;
     void render(ShaderProgram* program) override;
+    const char*   get_level_filepath() const override;
+    EmbeddedLevel get_embedded_level() const override;
 };
\ No newline at end of file
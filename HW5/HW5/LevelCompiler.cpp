@@ -0,0 +1,777 @@
+#include "LevelCompiler.h"
+#include "Entity.h"
+#include "Map.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+
+#define LOG(argument) std::cout << argument << '\n'
+
+#define TILED_GID_MASK 0x0FFFFFFF // the bits above are Tiled's flip and rotation flags
+
+static float to_float(const std::string& text, float fallback = 0.0f)
+{
+    if (text.empty()) return fallback;
+    return (float)strtod(text.c_str(), NULL);
+}
+
+static std::string to_lower(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+    return text;
+}
+
+static std::string trim(const std::string& text)
+{
+    size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) return "";
+    return text.substr(first, text.find_last_not_of(" \t\r\n") + 1 - first);
+}
+
+/*
+* @param type, player, door or enemy, in any case
+* @param x, y, world position
+* @return false for any other type
+*/
+static bool add_spawn(LevelSource& level, const std::string& type, float x, float y)
+{
+    std::string name = to_lower(type);
+
+    LevelSpawn spawn = { 0, PATROL, x, y };
+    if (name == "player")     spawn.entity_type = PLAYER;
+    else if (name == "door")  spawn.entity_type = DOOR;
+    else if (name == "enemy") spawn.entity_type = ENEMY;
+    else return false;
+
+    level.spawns.push_back(spawn);
+    return true;
+}
+
+/*
+* Tiled counts tiles from firstgid with 0 as empty, while Map draws id % tile set size --
+* so the tile set's first tile becomes the id one past its last
+*/
+static unsigned int from_tiled_gid(unsigned int gid, unsigned int first_gid, int tile_set_size)
+{
+    gid &= TILED_GID_MASK;
+    if (gid < first_gid) return 0;
+
+    unsigned int tile = gid - first_gid;
+    return tile == 0 ? (unsigned int)tile_set_size : tile;
+}
+
+/*
+* Adds a Tiled object as a spawn, placed at its centre
+* Tiled measures in pixels from the top left, and tile objects hang up from their position
+*/
+static void add_tiled_spawn(LevelSource& level, const std::string& type, float x, float y, float width, float height,
+    bool is_tile_object, float tile_width, float tile_height)
+{
+    float centre_x = x + width / 2;
+    float centre_y = is_tile_object ? y - height / 2 : y + height / 2;
+
+    // tile centres sit on whole world units, see Map::is_solid
+    float world_x = (centre_x / tile_width - 0.5f) * level.tile_size;
+    float world_y = -(centre_y / tile_height - 0.5f) * level.tile_size;
+
+    if (!add_spawn(level, type, world_x, world_y)) LOG("Ignoring object of type \"" << type << "\".");
+}
+
+/*
+* @param text, the whole CSV file
+* @param level, filled in
+*/
+bool LevelCompiler::read_csv(const std::string& text, LevelSource& level)
+{
+    std::vector<unsigned int> tiles;
+    std::istringstream lines(text);
+    std::string line;
+    int line_number = 0;
+
+    while (std::getline(lines, line))
+    {
+        line_number++;
+        line = trim(line);
+        if (line.empty() || line[0] == '#') continue;
+
+        std::vector<std::string> fields;
+        std::istringstream values(line);
+        std::string field;
+        while (std::getline(values, field, ',')) fields.push_back(trim(field));
+
+        std::string setting = to_lower(fields[0]);
+        if (setting == "tileset" && fields.size() == 3)
+        {
+            level.tile_count_x = atoi(fields[1].c_str());
+            level.tile_count_y = atoi(fields[2].c_str());
+        }
+        else if (setting == "tile_size" && fields.size() == 2) level.tile_size = to_float(fields[1], 1.0f);
+        else if (setting == "spawn" && fields.size() == 4)
+        {
+            if (!add_spawn(level, fields[1], to_float(fields[2]), to_float(fields[3])))
+            {
+                LOG("Line " << line_number << ": unknown spawn type \"" << fields[1] << "\".");
+                return false;
+            }
+        }
+        else if (isdigit((unsigned char)setting[0]))
+        {
+            // the first row decides the width, the rest have to match
+            if (level.height == 0) level.width = (int)fields.size();
+            if ((int)fields.size() != level.width)
+            {
+                LOG("Line " << line_number << ": row has " << fields.size() << " tiles, expected " << level.width << ".");
+                return false;
+            }
+
+            for (const std::string& tile : fields) tiles.push_back((unsigned int)strtoul(tile.c_str(), NULL, 10));
+            level.height++;
+        }
+        else
+        {
+            LOG("Line " << line_number << ": can't read \"" << line << "\".");
+            return false;
+        }
+    }
+
+    level.layers.push_back(tiles);
+    return true;
+}
+
+// value of name="..." inside one XML tag, empty if the tag doesn't have it
+static std::string get_attribute(const std::string& tag, const std::string& name)
+{
+    size_t start = tag.find(" " + name + "=\"");
+    if (start == std::string::npos) return "";
+
+    start += name.size() + 3;
+    return tag.substr(start, tag.find('"', start) - start);
+}
+
+/*
+* Reads the parts of a Tiled TMX map the game uses -- tile layers saved as CSV and objects
+* This is a scan of the tags rather than an XML parser, which is enough for what Tiled writes
+*
+* @param text, the whole TMX file
+* @param level, filled in
+*/
+bool LevelCompiler::read_tmx(const std::string& text, LevelSource& level)
+{
+    float tile_width = 1.0f;
+    float tile_height = 1.0f;
+    unsigned int first_gid = 0;
+    int tile_set_size = 0;
+
+    size_t position = 0;
+    while ((position = text.find('<', position)) != std::string::npos)
+    {
+        size_t end = text.find('>', position);
+        if (end == std::string::npos) break;
+
+        std::string tag = text.substr(position, end + 1 - position);
+        std::string name = tag.substr(1, tag.find_first_of(" \t\r\n/>", 1) - 1);
+        position = end + 1;
+
+        if (name == "map")
+        {
+            if (get_attribute(tag, "infinite") == "1")
+            {
+                LOG("Infinite maps aren't supported.");
+                return false;
+            }
+
+            level.width = atoi(get_attribute(tag, "width").c_str());
+            level.height = atoi(get_attribute(tag, "height").c_str());
+            tile_width = to_float(get_attribute(tag, "tilewidth"), 1.0f);
+            tile_height = to_float(get_attribute(tag, "tileheight"), 1.0f);
+        }
+        else if (name == "tileset" && tile_set_size == 0)
+        {
+            if (!get_attribute(tag, "source").empty())
+            {
+                LOG("The tile set has to be embedded in the map.");
+                return false;
+            }
+
+            first_gid = (unsigned int)atoi(get_attribute(tag, "firstgid").c_str());
+            level.tile_count_x = atoi(get_attribute(tag, "columns").c_str());
+            tile_set_size = atoi(get_attribute(tag, "tilecount").c_str());
+            level.tile_count_y = level.tile_count_x > 0 ? tile_set_size / level.tile_count_x : 0;
+        }
+        else if (name == "data")
+        {
+            if (get_attribute(tag, "encoding") != "csv")
+            {
+                LOG("Tile layers have to be saved as CSV.");
+                return false;
+            }
+
+            size_t data_end = text.find("</data>", position);
+            std::istringstream values(text.substr(position, data_end - position));
+            std::vector<unsigned int> tiles;
+            std::string value;
+            while (std::getline(values, value, ','))
+            {
+                tiles.push_back(from_tiled_gid((unsigned int)strtoul(trim(value).c_str(), NULL, 10), first_gid, tile_set_size));
+            }
+
+            level.layers.push_back(tiles);
+            position = data_end;
+        }
+        else if (name == "object")
+        {
+            std::string type = get_attribute(tag, "type");
+            if (type.empty()) type = get_attribute(tag, "class");
+
+            add_tiled_spawn(level, type, to_float(get_attribute(tag, "x")), to_float(get_attribute(tag, "y")),
+                to_float(get_attribute(tag, "width")), to_float(get_attribute(tag, "height")),
+                !get_attribute(tag, "gid").empty(), tile_width, tile_height);
+        }
+    }
+
+    return true;
+}
+
+// just enough JSON for Tiled maps
+struct JsonValue
+{
+    enum JsonType { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+
+    JsonType    type = JSON_NULL;
+    double      number = 0.0;
+    std::string string;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    const JsonValue* get(const char* key) const
+    {
+        for (const std::pair<std::string, JsonValue>& member : members)
+        {
+            if (member.first == key) return &member.second;
+        }
+        return NULL;
+    }
+
+    double get_number(const char* key, double fallback = 0.0) const
+    {
+        const JsonValue* value = get(key);
+        if (value == NULL) return fallback;
+        if (value->type == JSON_BOOL || value->type == JSON_NUMBER) return value->number;
+        return fallback;
+    }
+
+    std::string get_string(const char* key) const
+    {
+        const JsonValue* value = get(key);
+        return value != NULL && value->type == JSON_STRING ? value->string : "";
+    }
+};
+
+static void skip_space(const char*& c, const char* end)
+{
+    while (c < end && isspace((unsigned char)*c)) c++;
+}
+
+static bool parse_json_string(const char*& c, const char* end, std::string& string)
+{
+    if (c >= end || *c != '"') return false;
+    c++;
+
+    while (c < end && *c != '"')
+    {
+        if (*c == '\\' && c + 1 < end)
+        {
+            c++;
+            switch (*c)
+            {
+            case 'n': string += '\n'; break;
+            case 't': string += '\t'; break;
+            case 'r': string += '\r'; break;
+            case 'b': string += '\b'; break;
+            case 'f': string += '\f'; break;
+            case 'u': string += '?'; c += std::min((long)4, (long)(end - c - 1)); break; // names here are plain ASCII
+            default:  string += *c; break;
+            }
+        }
+        else string += *c;
+        c++;
+    }
+
+    if (c >= end) return false;
+    c++;
+    return true;
+}
+
+static bool parse_json(const char*& c, const char* end, JsonValue& value)
+{
+    skip_space(c, end);
+    if (c >= end) return false;
+
+    if (*c == '{')
+    {
+        value.type = JsonValue::JSON_OBJECT;
+        c++;
+        skip_space(c, end);
+        if (c < end && *c == '}') { c++; return true; }
+
+        while (c < end)
+        {
+            std::pair<std::string, JsonValue> member;
+            skip_space(c, end);
+            if (!parse_json_string(c, end, member.first)) return false;
+
+            skip_space(c, end);
+            if (c >= end || *c != ':') return false;
+            c++;
+
+            if (!parse_json(c, end, member.second)) return false;
+            value.members.push_back(std::move(member));
+
+            skip_space(c, end);
+            if (c < end && *c == ',') { c++; continue; }
+            if (c < end && *c == '}') { c++; return true; }
+            return false;
+        }
+        return false;
+    }
+
+    if (*c == '[')
+    {
+        value.type = JsonValue::JSON_ARRAY;
+        c++;
+        skip_space(c, end);
+        if (c < end && *c == ']') { c++; return true; }
+
+        while (c < end)
+        {
+            value.items.push_back(JsonValue());
+            if (!parse_json(c, end, value.items.back())) return false;
+
+            skip_space(c, end);
+            if (c < end && *c == ',') { c++; continue; }
+            if (c < end && *c == ']') { c++; return true; }
+            return false;
+        }
+        return false;
+    }
+
+    if (*c == '"')
+    {
+        value.type = JsonValue::JSON_STRING;
+        return parse_json_string(c, end, value.string);
+    }
+
+    if (end - c >= 4 && strncmp(c, "true", 4) == 0)  { value.type = JsonValue::JSON_BOOL; value.number = 1.0; c += 4; return true; }
+    if (end - c >= 5 && strncmp(c, "false", 5) == 0) { value.type = JsonValue::JSON_BOOL; value.number = 0.0; c += 5; return true; }
+    if (end - c >= 4 && strncmp(c, "null", 4) == 0)  { c += 4; return true; }
+
+    // numbers -- the file ends in a brace, so strtod can't run off the end
+    char* number_end;
+    value.number = strtod(c, &number_end);
+    if (number_end == c) return false;
+
+    value.type = JsonValue::JSON_NUMBER;
+    c = number_end;
+    return true;
+}
+
+// tile and object layers, including the ones inside group layers
+static bool read_json_layers(const JsonValue& layers, LevelSource& level, unsigned int first_gid, int tile_set_size,
+    float tile_width, float tile_height)
+{
+    for (const JsonValue& layer : layers.items)
+    {
+        std::string type = layer.get_string("type");
+
+        if (type == "tilelayer")
+        {
+            const JsonValue* data = layer.get("data");
+            if (data == NULL || data->type != JsonValue::JSON_ARRAY)
+            {
+                LOG("Tile layers have to be saved as CSV.");
+                return false;
+            }
+
+            std::vector<unsigned int> tiles;
+            for (const JsonValue& gid : data->items) tiles.push_back(from_tiled_gid((unsigned int)gid.number, first_gid, tile_set_size));
+            level.layers.push_back(tiles);
+        }
+        else if (type == "objectgroup" && layer.get("objects") != NULL)
+        {
+            for (const JsonValue& object : layer.get("objects")->items)
+            {
+                std::string object_type = object.get_string("type");
+                if (object_type.empty()) object_type = object.get_string("class");
+
+                add_tiled_spawn(level, object_type, (float)object.get_number("x"), (float)object.get_number("y"),
+                    (float)object.get_number("width"), (float)object.get_number("height"),
+                    object.get("gid") != NULL, tile_width, tile_height);
+            }
+        }
+        else if (type == "group" && layer.get("layers") != NULL)
+        {
+            if (!read_json_layers(*layer.get("layers"), level, first_gid, tile_set_size, tile_width, tile_height)) return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+* Reads a map saved from Tiled as JSON
+*
+* @param text, the whole JSON file
+* @param level, filled in
+*/
+bool LevelCompiler::read_json(const std::string& text, LevelSource& level)
+{
+    JsonValue map;
+    const char* c = text.data();
+    if (!parse_json(c, text.data() + text.size(), map) || map.type != JsonValue::JSON_OBJECT)
+    {
+        LOG("Not a JSON map.");
+        return false;
+    }
+
+    if (map.get_number("infinite") != 0.0)
+    {
+        LOG("Infinite maps aren't supported.");
+        return false;
+    }
+
+    level.width = (int)map.get_number("width");
+    level.height = (int)map.get_number("height");
+    float tile_width = (float)map.get_number("tilewidth", 1.0);
+    float tile_height = (float)map.get_number("tileheight", 1.0);
+
+    unsigned int first_gid = 0;
+    int tile_set_size = 0;
+    const JsonValue* tile_sets = map.get("tilesets");
+    if (tile_sets != NULL && !tile_sets->items.empty())
+    {
+        const JsonValue& tile_set = tile_sets->items[0];
+        if (tile_set.get("source") != NULL)
+        {
+            LOG("The tile set has to be embedded in the map.");
+            return false;
+        }
+
+        first_gid = (unsigned int)tile_set.get_number("firstgid");
+        level.tile_count_x = (int)tile_set.get_number("columns");
+        tile_set_size = (int)tile_set.get_number("tilecount");
+        level.tile_count_y = level.tile_count_x > 0 ? tile_set_size / level.tile_count_x : 0;
+    }
+
+    const JsonValue* layers = map.get("layers");
+    if (layers == NULL) return true;
+    return read_json_layers(*layers, level, first_gid, tile_set_size, tile_width, tile_height);
+}
+
+/*
+* Reads an authored level, by its extension -- .tmx, .json, anything else as CSV
+*
+* @param filepath, path to the level
+* @param level, filled in and checked
+*/
+bool LevelCompiler::read(const std::string& filepath, LevelSource& level)
+{
+    std::ifstream file(filepath, std::ios::binary);
+    if (file.fail())
+    {
+        LOG("Unable to read " << filepath << ".");
+        return false;
+    }
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    level = LevelSource();
+
+    std::string extension = to_lower(filepath.substr(std::min(filepath.find_last_of('.'), filepath.size())));
+    bool is_read;
+    if (extension == ".tmx")       is_read = read_tmx(text, level);
+    else if (extension == ".json") is_read = read_json(text, level);
+    else                           is_read = read_csv(text, level);
+    if (!is_read) return false;
+
+    if (level.width <= 0 || level.height <= 0 || level.layers.empty())
+    {
+        LOG(filepath << " has no tiles.");
+        return false;
+    }
+    if (level.tile_count_x <= 0 || level.tile_count_y <= 0)
+    {
+        LOG(filepath << " doesn't say how the tile set is laid out.");
+        return false;
+    }
+    for (const std::vector<unsigned int>& layer : level.layers)
+    {
+        if (layer.size() != (size_t)level.width * level.height)
+        {
+            LOG(filepath << " has a layer of " << layer.size() << " tiles, expected " << level.width * level.height << ".");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template <typename T>
+static uint32_t append(std::vector<unsigned char>& bytes, const T* data, size_t count)
+{
+    uint32_t offset = (uint32_t)bytes.size();
+    bytes.insert(bytes.end(), (const unsigned char*)data, (const unsigned char*)(data + count));
+    return offset;
+}
+
+// appends tile ids as T, which has to hold them all
+template <typename T>
+static void append_narrowed(std::vector<unsigned char>& bytes, const std::vector<unsigned int>& tiles)
+{
+    std::vector<T> narrowed(tiles.begin(), tiles.end());
+    append(bytes, narrowed.data(), narrowed.size());
+}
+
+/*
+* Bakes a level and writes it as a level file
+* The baking is done by a Map over the level, so the result is exactly what Map would build at load time
+*
+* @param filepath, where the level file goes
+* @param level, a level from read()
+*/
+bool LevelCompiler::write(const std::string& filepath, const LevelSource& level)
+{
+    Map map(level.width, level.height, level.layers[0].data(), 0, 0, level.tile_size, level.tile_count_x, level.tile_count_y);
+
+    LevelFileHeader header = {};
+    memcpy(header.magic, "HWLV", 4);
+    header.version = LEVEL_FILE_VERSION;
+    header.width = (uint32_t)level.width;
+    header.height = (uint32_t)level.height;
+    header.tile_size = level.tile_size;
+    header.tile_count_x = (uint32_t)level.tile_count_x;
+    header.tile_count_y = (uint32_t)level.tile_count_y;
+    header.layer_count = (uint32_t)level.layers.size();
+    header.spawn_count = (uint32_t)level.spawns.size();
+    header.chunk_size = MAP_CHUNK_SIZE;
+
+    // everything here is a multiple of 4 bytes, so every section stays aligned
+    std::vector<unsigned char> bytes;
+    append(bytes, &header, 1);
+
+    // ids are stored as narrow as the biggest one allows
+    unsigned int max_tile = 0;
+    for (const std::vector<unsigned int>& layer : level.layers)
+    {
+        if (!layer.empty()) max_tile = std::max(max_tile, *std::max_element(layer.begin(), layer.end()));
+    }
+    header.tile_index_size = (uint32_t)SparseTileLayer::get_index_size(max_tile);
+
+    // layers are run-length encoded when that is smaller, which it is for all but the noisiest levels
+    size_t dense_layer_size = ((size_t)level.width * level.height * header.tile_index_size + 3) / 4 * 4;
+    size_t dense_size = dense_layer_size * level.layers.size();
+    size_t rle_size = level.layers.size() * sizeof(uint32_t);
+    for (const std::vector<unsigned int>& layer : level.layers) rle_size += RleTileLayer::get_encoded_size(level.width, level.height, layer.data());
+
+    header.layer_encoding = rle_size < dense_size ? LEVEL_LAYERS_RLE : LEVEL_LAYERS_DENSE;
+    if (header.layer_encoding == LEVEL_LAYERS_DENSE)
+    {
+        header.layer_offset = (uint32_t)bytes.size();
+        for (size_t i = 0; i < level.layers.size(); i++)
+        {
+            switch (header.tile_index_size)
+            {
+            case 1:  append_narrowed<uint8_t>(bytes, level.layers[i]); break;
+            case 2:  append_narrowed<uint16_t>(bytes, level.layers[i]); break;
+            default: append(bytes, level.layers[i].data(), level.layers[i].size()); break;
+            }
+            bytes.resize(header.layer_offset + (i + 1) * dense_layer_size, 0); // pad to 4 bytes
+        }
+    }
+    else
+    {
+        std::vector<uint32_t> layer_offsets(level.layers.size());
+        header.layer_offset = append(bytes, layer_offsets.data(), layer_offsets.size());
+        for (size_t i = 0; i < level.layers.size(); i++)
+        {
+            RleTileLayer tiles;
+            tiles.encode(level.width, level.height, level.layers[i].data());
+            layer_offsets[i] = append(bytes, tiles.get_row_offsets(), (size_t)level.height + 1);
+            append(bytes, tiles.get_runs(), (size_t)tiles.get_run_count());
+        }
+        memcpy(bytes.data() + header.layer_offset, layer_offsets.data(), layer_offsets.size() * sizeof(uint32_t));
+    }
+
+    header.spawn_offset = append(bytes, level.spawns.data(), level.spawns.size());
+
+    std::vector<LevelChunk> chunks(map.m_chunks.size());
+    header.chunk_offset = append(bytes, chunks.data(), chunks.size());
+
+    int quad_count = 0;
+    int occluder_count = 0;
+    for (size_t i = 0; i < map.m_chunks.size(); i++)
+    {
+        MapChunk& chunk = map.m_chunks[i];
+        const std::vector<OccluderEdge>& occluders = map.get_chunk_occluders(chunk);
+
+        std::vector<TileVertex> vertices;
+        map.build_chunk(chunk.chunk_x, chunk.chunk_y, map.is_baked(), vertices);
+
+        chunks[i].vertex_offset = append(bytes, vertices.data(), vertices.size());
+        chunks[i].vertex_count = (uint32_t)vertices.size();
+        chunks[i].occluder_offset = append(bytes, occluders.data(), occluders.size());
+        chunks[i].occluder_count = (uint32_t)occluders.size();
+
+        quad_count += (int)vertices.size() / 4;
+        occluder_count += (int)occluders.size();
+    }
+
+    // one bit per tile of the first layer, each row padded to a whole uint32_t like Map's
+    std::vector<uint32_t> solid_mask((size_t)map.m_solid_mask_stride * level.height, 0);
+    size_t tile_count = 0;
+    for (int y = 0; y < level.height; y++)
+    {
+        for (int x = 0; x < level.width; x++)
+        {
+            if (map.get_tile(x, y) == 0) continue;
+            solid_mask[y * map.m_solid_mask_stride + (x >> 5)] |= 1u << (x & 31);
+            tile_count++;
+        }
+    }
+    header.solid_offset = append(bytes, solid_mask.data(), solid_mask.size());
+
+    // the offsets are only known now
+    memcpy(bytes.data(), &header, sizeof(header));
+    memcpy(bytes.data() + header.chunk_offset, chunks.data(), chunks.size() * sizeof(LevelChunk));
+
+    std::ofstream file(filepath, std::ios::binary);
+    if (file.fail())
+    {
+        LOG("Unable to write " << filepath << ".");
+        return false;
+    }
+    file.write((const char*)bytes.data(), bytes.size());
+    if (file.fail()) return false;
+
+    LOG(filepath << ": " << level.width << "x" << level.height << " tiles, " << level.spawns.size() << " spawns, " <<
+        chunks.size() << " chunks, " << quad_count << " quads, " << occluder_count << " occluders, " << bytes.size() << " bytes");
+    LOG("  tile layers: " << header.tile_index_size << " byte ids, " << dense_size << " bytes dense, " << rle_size <<
+        " bytes run-length encoded, stored " << (header.layer_encoding == LEVEL_LAYERS_RLE ? "run-length encoded" : "dense") <<
+        ", and a " << solid_mask.size() * sizeof(uint32_t) << " byte solidity mask");
+
+    // against a mesh of two unshared triangles per tile, with separate float position and uv arrays
+    size_t vertex_bytes = (size_t)quad_count * 4 * sizeof(TileVertex);
+    size_t triangle_bytes = tile_count * 6 * (2 + 2) * sizeof(float);
+    LOG("  meshes: " << tile_count << " tiles in " << quad_count << " quads, " << vertex_bytes << " vertex bytes (" <<
+        triangle_bytes << " as float triangles per tile, " << (vertex_bytes > 0 ? (double)triangle_bytes / vertex_bytes : 0.0) << "x)");
+    return true;
+}
+
+/*
+* @param source_filepath, the authored level
+* @param level_filepath, where the level file goes
+*/
+bool LevelCompiler::compile(const std::string& source_filepath, const std::string& level_filepath)
+{
+    LevelSource level;
+    return read(source_filepath, level) && write(level_filepath, level);
+}
+
+/*
+* What check() compares a copy of a level against its source
+*
+* @param level, the level file or built-in copy, open
+* @param source, what it was made from
+* @param name, how the copy is called in the log
+*/
+static bool matches_source(const LevelFile& level, const LevelSource& source, const std::string& name)
+{
+    if (level.get_width() != source.width || level.get_height() != source.height || level.get_tile_size() != source.tile_size ||
+        level.get_tile_count_x() != source.tile_count_x || level.get_tile_count_y() != source.tile_count_y)
+    {
+        LOG(name << " has a different size, tile size or tile set.");
+        return false;
+    }
+
+    Map map(level, 0, 0);
+    for (int y = 0; y < source.height; y++)
+    {
+        for (int x = 0; x < source.width; x++)
+        {
+            if (map.get_tile(x, y) == source.layers[0][y * source.width + x]) continue;
+            LOG(name << " has a different tile at " << x << ", " << y << ".");
+            return false;
+        }
+    }
+
+    if (level.get_spawn_count() != (int)source.spawns.size() ||
+        (!source.spawns.empty() && memcmp(level.get_spawns(), source.spawns.data(), source.spawns.size() * sizeof(LevelSpawn)) != 0))
+    {
+        LOG(name << " has different spawns.");
+        return false;
+    }
+
+    return true;
+}
+
+/*
+* Checks that a level file and the built-in copy a scene carries both still
+* hold what the source says, and that the meshes, occluders, solidity mask and
+* bounds baked into the built-in copy at compile time are the ones the level
+* compiler baked into the file
+*
+* @param source_filepath, the authored level
+* @param level_filepath, the level file compiled from it
+* @param embedded, the scene's built-in copy
+* @return false, with what differs in the log, if any of them disagree
+*/
+bool LevelCompiler::check(const std::string& source_filepath, const std::string& level_filepath, const EmbeddedLevel& embedded)
+{
+    LevelSource source;
+    LevelFile file, built_in;
+    if (!read(source_filepath, source) || !file.open(level_filepath)) return false;
+    built_in.open_embedded(embedded);
+
+    std::string built_in_name = "The built-in copy of " + level_filepath;
+    if (!matches_source(file, source, level_filepath) || !matches_source(built_in, source, built_in_name)) return false;
+
+    if (!file.is_baked() || file.get_chunk_size() != MAP_CHUNK_SIZE || built_in.get_chunk_size() != MAP_CHUNK_SIZE)
+    {
+        LOG(level_filepath << " isn't baked for " << MAP_CHUNK_SIZE << " tile chunks, compile it again.");
+        return false;
+    }
+
+    int chunk_count = ((source.width + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE) * ((source.height + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE);
+    for (int i = 0; i < chunk_count; i++)
+    {
+        const LevelChunk& a = file.get_chunks()[i];
+        const LevelChunk& b = built_in.get_chunks()[i];
+        if (a.vertex_count != b.vertex_count || a.occluder_count != b.occluder_count ||
+            memcmp(file.get_vertex_data() + a.vertex_offset, built_in.get_vertex_data() + b.vertex_offset, a.vertex_count * sizeof(TileVertex)) != 0 ||
+            memcmp(file.get_occluder_data() + a.occluder_offset, built_in.get_occluder_data() + b.occluder_offset, a.occluder_count * sizeof(OccluderEdge)) != 0)
+        {
+            LOG(built_in_name << " has a different mesh or occluders in chunk " << i << ".");
+            return false;
+        }
+    }
+
+    if (memcmp(file.get_solid_mask(), built_in.get_solid_mask(), (size_t)(source.width + 31) / 32 * source.height * sizeof(uint32_t)) != 0)
+    {
+        LOG(built_in_name << " has a different solidity mask.");
+        return false;
+    }
+
+    Map map(file, 0, 0);
+    if (map.get_left_bound() != embedded.left_bound || map.get_right_bound() != embedded.right_bound ||
+        map.get_top_bound() != embedded.top_bound || map.get_bottom_bound() != embedded.bottom_bound)
+    {
+        LOG(built_in_name << " has different bounds.");
+        return false;
+    }
+
+    LOG(level_filepath << " and its built-in copy match " << source_filepath << ".");
+    return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <string>
+#include "LevelFile.h"
+
+// a level as it was authored, before it is baked
+struct LevelSource
+{
+    int   width = 0;
+    int   height = 0;
+    float tile_size = 1.0f;
+    int   tile_count_x = 0;
+    int   tile_count_y = 1;
+
+    std::vector<std::vector<unsigned int>> layers; // width * height ids each, 0 for empty
+    std::vector<LevelSpawn> spawns;
+};
+
+/*
+* Turns authored levels into the level files the game maps
+*
+* Reads Tiled maps (.tmx with CSV layer data, or .json) or plain .csv files,
+* then runs the same chunk mesh, occluder and solidity mask builders Map uses
+* and stores their output, so loading a level does no per-tile work.
+*
+* CSV levels are rows of tile ids plus a few lines of settings:
+*   tileset,<tiles across>,<tiles down>
+*   tile_size,<world units>          (1 if left out)
+*   spawn,<player|door|enemy>,<x>,<y> (x and y in world units, like Entity positions)
+* Lines starting with # are comments.
+*
+* In Tiled, spawns are objects whose type (or class) is player, door or enemy.
+* Tiled maps need their one tile set embedded, and TMX layers saved as CSV.
+*
+* check() makes sure a level file and a scene's built-in copy (see
+* EmbeddedLevel.h) still agree with the source they were both made from.
+*/
+class LevelCompiler
+{
+private:
+    static bool read_csv(const std::string& text, LevelSource& level);
+    static bool read_tmx(const std::string& text, LevelSource& level);
+    static bool read_json(const std::string& text, LevelSource& level);
+
+public:
+    static bool read(const std::string& filepath, LevelSource& level);
+    static bool write(const std::string& filepath, const LevelSource& level);
+    static bool compile(const std::string& source_filepath, const std::string& level_filepath);
+    static bool check(const std::string& source_filepath, const std::string& level_filepath, const EmbeddedLevel& embedded);
+};
@@ -0,0 +1,271 @@
+#include "LevelFile.h"
+#include "AssetPack.h"
+#include <iostream>
+#include <cstring>
+
+#define LOG(argument) std::cout << argument << '\n'
+
+/*
+* Checks the tile layers fit in the file -- for run-length encoded layers
+* that means every layer's row offsets only go forward and end inside it
+*/
+static bool has_valid_layers(const LevelFileHeader& header, const unsigned char* data, size_t size)
+{
+    uint64_t row_count = header.height;
+    if (header.tile_index_size != 1 && header.tile_index_size != 2 && header.tile_index_size != 4) return false;
+    if (header.layer_encoding == LEVEL_LAYERS_DENSE)
+    {
+        uint64_t layer_size = ((uint64_t)header.width * row_count * header.tile_index_size + 3) / 4 * 4;
+        return header.layer_offset + header.layer_count * layer_size <= size;
+    }
+    if (header.layer_encoding != LEVEL_LAYERS_RLE) return false;
+
+    if (header.layer_offset + (uint64_t)header.layer_count * sizeof(uint32_t) > size) return false;
+    const uint32_t* layer_offsets = (const uint32_t*)(data + header.layer_offset);
+    for (uint32_t layer = 0; layer < header.layer_count; layer++)
+    {
+        uint64_t runs_offset = layer_offsets[layer] + (row_count + 1) * sizeof(uint32_t);
+        if (layer_offsets[layer] % 4 != 0 || runs_offset > size) return false;
+
+        const uint32_t* row_offsets = (const uint32_t*)(data + layer_offsets[layer]);
+        if (row_offsets[0] != 0) return false;
+        for (uint64_t y = 0; y < row_count; y++)
+        {
+            if (row_offsets[y + 1] < row_offsets[y]) return false;
+        }
+        if (runs_offset + (uint64_t)row_offsets[row_count] * sizeof(TileRun) > size) return false;
+    }
+
+    return true;
+}
+
+/*
+* Maps a level, from the asset pack if it has it and from its own file otherwise
+* Only the header and the layout are checked here -- tiles are read as they are used
+*
+* @param filepath, path to the level file
+* @param fallback, a built-in copy of the level to use if the file can't be opened, or NULL
+*/
+bool LevelFile::open(const std::string& filepath, const EmbeddedLevel* fallback)
+{
+    close();
+    if (open_file(filepath)) return true;
+    if (fallback == NULL) return false;
+
+    LOG("Using the built-in copy of " << filepath << ".");
+    open_embedded(*fallback);
+    return true;
+}
+
+/*
+* Uses a level built into the game -- nothing is read from disk
+*
+* @param level, the built-in level -- what it points at has to outlive this
+*/
+void LevelFile::open_embedded(const EmbeddedLevel& level)
+{
+    close();
+    m_embedded = level;
+    m_header.width = (uint32_t)level.width;
+    m_header.height = (uint32_t)level.height;
+    m_header.tile_size = level.tile_size;
+    m_header.tile_count_x = (uint32_t)level.tile_count_x;
+    m_header.tile_count_y = (uint32_t)level.tile_count_y;
+    m_header.layer_count = 1;
+    m_header.layer_encoding = LEVEL_LAYERS_DENSE;
+    m_header.tile_index_size = sizeof(unsigned int);
+    m_header.spawn_count = (uint32_t)level.spawn_count;
+    m_header.chunk_size = (uint32_t)level.chunk_size;
+}
+
+bool LevelFile::open_file(const std::string& filepath)
+{
+    const unsigned char* data;
+    size_t size;
+    std::shared_ptr<MappedFile> file;
+    if (AssetPack::get()->find(filepath, ASSET_RAW, &data, &size)) file = AssetPack::get()->get_file();
+    else
+    {
+        file = std::make_shared<MappedFile>();
+        if (!file->open(filepath))
+        {
+            LOG("Unable to open level " << filepath << ".");
+            return false;
+        }
+        data = file->get_data();
+        size = file->get_size();
+    }
+
+    LevelFileHeader header;
+    if (size < sizeof(header))
+    {
+        LOG("Level " << filepath << " is truncated.");
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+
+    uint64_t spawn_end = header.spawn_offset + (uint64_t)header.spawn_count * sizeof(LevelSpawn);
+    if (memcmp(header.magic, "HWLV", 4) != 0 || header.version != LEVEL_FILE_VERSION)
+    {
+        LOG("Level " << filepath << " is not a version " << LEVEL_FILE_VERSION << " level.");
+        return false;
+    }
+    if (header.layer_count == 0 || header.layer_offset % 4 != 0 || header.spawn_offset % 4 != 0 ||
+        !has_valid_layers(header, data, size) || spawn_end > size)
+    {
+        LOG("Level " << filepath << " is truncated.");
+        return false;
+    }
+
+    if (header.chunk_size != 0)
+    {
+        uint64_t chunk_count = (uint64_t)((header.width + header.chunk_size - 1) / header.chunk_size) *
+            ((header.height + header.chunk_size - 1) / header.chunk_size);
+        uint64_t solid_end = header.solid_offset + (uint64_t)(header.width + 31) / 32 * header.height * sizeof(uint32_t);
+        bool is_valid = header.chunk_offset % 4 == 0 && header.solid_offset % 4 == 0 &&
+            header.chunk_offset + chunk_count * sizeof(LevelChunk) <= size && solid_end <= size;
+
+        // meshes and occluders are 8 and 16 bytes apiece
+        const LevelChunk* chunks = (const LevelChunk*)(data + header.chunk_offset);
+        for (uint64_t i = 0; i < chunk_count && is_valid; i++)
+        {
+            is_valid = chunks[i].vertex_offset % 4 == 0 && chunks[i].occluder_offset % 4 == 0 &&
+                chunks[i].vertex_offset + (uint64_t)chunks[i].vertex_count * 8 <= size &&
+                chunks[i].occluder_offset + (uint64_t)chunks[i].occluder_count * 16 <= size;
+        }
+
+        if (!is_valid)
+        {
+            LOG("Level " << filepath << " has broken baked data.");
+            return false;
+        }
+    }
+
+    m_file = file;
+    m_data = data;
+    m_size = size;
+    m_header = header;
+
+    return true;
+}
+
+void LevelFile::close()
+{
+    m_file.reset();
+    m_data = NULL;
+    m_size = 0;
+    m_header = LevelFileHeader();
+    m_embedded = EmbeddedLevel();
+}
+
+/*
+* @return bytes each dense layer takes in the file, padding included
+*/
+size_t LevelFile::get_dense_layer_size() const
+{
+    return ((size_t)m_header.width * m_header.height * m_header.tile_index_size + 3) / 4 * 4;
+}
+
+/*
+* @param layer, which tile layer, 0 being the one drawn and collided with
+* @return width * height tile ids inside the mapping, get_tile_index_size() bytes each,
+* or NULL if there is no such layer or the layers are run-length encoded
+*/
+const void* LevelFile::get_layer(int layer) const
+{
+    if (is_embedded()) return layer == 0 ? m_embedded.tiles : NULL;
+    if (m_data == NULL || layer < 0 || layer >= (int)m_header.layer_count || is_rle()) return NULL;
+
+    return m_data + m_header.layer_offset + layer * get_dense_layer_size();
+}
+
+/*
+* Points tiles at a run-length encoded layer inside the mapping
+*
+* @param layer, which tile layer, 0 being the one drawn and collided with
+* @param tiles, set to read the layer in place
+* @return false if there is no such layer or the layers aren't run-length encoded
+*/
+bool LevelFile::get_rle_layer(int layer, RleTileLayer& tiles) const
+{
+    if (m_data == NULL || layer < 0 || layer >= (int)m_header.layer_count || !is_rle()) return false;
+
+    uint32_t offset = ((const uint32_t*)(m_data + m_header.layer_offset))[layer];
+    const uint32_t* row_offsets = (const uint32_t*)(m_data + offset);
+    tiles.view(get_width(), get_height(), row_offsets, (const TileRun*)(row_offsets + m_header.height + 1));
+    return true;
+}
+
+/*
+* @return get_spawn_count() spawns in file order, or NULL if no level is open
+*/
+const LevelSpawn* LevelFile::get_spawns() const
+{
+    if (!is_open()) return NULL;
+    return is_embedded() ? m_embedded.spawns : (const LevelSpawn*)(m_data + m_header.spawn_offset);
+}
+
+/*
+* @param entity_type, the EntityType to look for
+* @param index, which spawn of that type, in file order
+* @return the spawn, or NULL if the level has no such spawn
+*/
+const LevelSpawn* LevelFile::find_spawn(uint32_t entity_type, int index) const
+{
+    const LevelSpawn* spawns = get_spawns();
+    if (spawns == NULL) return NULL;
+
+    for (uint32_t i = 0; i < m_header.spawn_count; i++)
+    {
+        if (spawns[i].entity_type == entity_type && index-- == 0) return &spawns[i];
+    }
+
+    return NULL;
+}
+
+/*
+* @param entity_type, the EntityType to look for
+* @param index, which spawn of that type, in file order
+* @return where the spawn is, or the origin if the level has no such spawn
+*/
+glm::vec3 LevelFile::get_spawn_position(uint32_t entity_type, int index) const
+{
+    const LevelSpawn* spawn = find_spawn(entity_type, index);
+    return spawn != NULL ? glm::vec3(spawn->x, spawn->y, 0.0f) : glm::vec3(0.0f);
+}
+
+/*
+* @return a LevelChunk per chunk, row by row, or NULL if the level isn't baked
+*/
+const LevelChunk* LevelFile::get_chunks() const
+{
+    if (is_embedded()) return m_embedded.chunks;
+    if (m_data == NULL || m_header.chunk_size == 0) return NULL;
+    return (const LevelChunk*)(m_data + m_header.chunk_offset);
+}
+
+/*
+* @return where the chunks' vertex offsets count from -- the start of the file, or a built-in level's meshes
+*/
+const unsigned char* LevelFile::get_vertex_data() const
+{
+    return is_embedded() ? m_embedded.vertex_data : m_data;
+}
+
+/*
+* @return where the chunks' occluder offsets count from -- the start of the file, or a built-in level's occluders
+*/
+const unsigned char* LevelFile::get_occluder_data() const
+{
+    return is_embedded() ? m_embedded.occluder_data : m_data;
+}
+
+/*
+* @return one bit per tile, set for solid tiles, or NULL if the level isn't baked or built in
+*/
+const uint32_t* LevelFile::get_solid_mask() const
+{
+    if (is_embedded()) return m_embedded.solid_mask;
+    if (m_data == NULL || m_header.chunk_size == 0) return NULL;
+    return (const uint32_t*)(m_data + m_header.solid_offset);
+}
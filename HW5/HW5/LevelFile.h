@@ -0,0 +1,140 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <cstdint>
+#include "glm/vec3.hpp"
+#include "MappedFile.h"
+#include "RleTileLayer.h"
+
+#define LEVEL_FILE_VERSION 4
+
+enum LevelLayerEncoding { LEVEL_LAYERS_DENSE, LEVEL_LAYERS_RLE };
+
+// start of every level file -- all offsets are from the start of the file
+struct LevelFileHeader
+{
+    char     magic[4]; // "HWLV"
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    float    tile_size;
+    uint32_t tile_count_x; // tiles across and down the tile set
+    uint32_t tile_count_y;
+    uint32_t layer_count;  // layer 0 is drawn and collided with
+    uint32_t layer_offset;
+    uint32_t layer_encoding; // LevelLayerEncoding
+    uint32_t tile_index_size; // bytes per tile id in dense layers, 1, 2 or 4 -- the smallest that holds every id
+    uint32_t spawn_count;
+    uint32_t spawn_offset;
+
+    // written by the level compiler (see LevelCompiler), all 0 if the level isn't baked
+    uint32_t chunk_size;   // MAP_CHUNK_SIZE the chunks were baked for
+    uint32_t chunk_offset; // a LevelChunk per chunk, row by row
+    uint32_t solid_offset; // one bit per tile, each row padded to a whole uint32_t
+};
+
+// where a chunk's baked mesh (TileVertex) and occluders (OccluderEdge) are in the file
+struct LevelChunk
+{
+    uint32_t vertex_offset;
+    uint32_t vertex_count;
+    uint32_t occluder_offset;
+    uint32_t occluder_count;
+};
+
+// where an entity starts the level
+struct LevelSpawn
+{
+    uint32_t entity_type; // EntityType
+    uint32_t ai_type;     // AIType, for enemies
+    float    x;
+    float    y;
+};
+
+// a level built into the game (see EmbeddedLevelData), used when its file can't be opened
+struct EmbeddedLevel
+{
+    int   width;
+    int   height;
+    float tile_size;
+    int   tile_count_x;
+    int   tile_count_y;
+
+    const unsigned int* tiles;      // width * height ids, row by row
+    const uint32_t*     solid_mask; // laid out like a level file's
+    const LevelSpawn*   spawns;
+    int                 spawn_count;
+
+    // baked like a compiled level's -- chunk offsets count from vertex_data and occluder_data
+    int                  chunk_size;
+    const LevelChunk*    chunks;
+    const unsigned char* vertex_data;
+    const unsigned char* occluder_data;
+
+    // the same as Map's
+    float left_bound, right_bound, top_bound, bottom_bound;
+};
+
+/*
+* A level read straight out of a memory mapped file, or out of the asset pack
+* when it has the level -- tile layers are handed to Map without a copy
+*
+* The file is a LevelFileHeader, the tile layers and then the spawn table.
+* Dense layers are width * height tile ids, row by row, each as wide as the
+* level's biggest id needs, and padded to a multiple of 4 bytes. Run-length encoded
+* layers start with a table of their offsets, and each is height + 1 row
+* offsets followed by its TileRuns (see RleTileLayer).
+* Compiled levels also carry the chunk meshes, occluders and solidity mask
+* that Map would otherwise build at load time, and so do built-in ones.
+* Everything is 4 byte aligned so it can all be read in place.
+* A scene can hand open() a built-in copy of its level to use instead when the
+* file is missing or broken.
+*/
+class LevelFile
+{
+private:
+    std::shared_ptr<MappedFile> m_file; // kept by every Map made from the level
+    const unsigned char* m_data = NULL;
+    size_t m_size = 0;
+
+    LevelFileHeader m_header = {};
+
+    EmbeddedLevel m_embedded = {}; // tiles are NULL unless the level is the built-in fallback
+
+    bool open_file(const std::string& filepath);
+
+public:
+    bool open(const std::string& filepath, const EmbeddedLevel* fallback = NULL);
+    void open_embedded(const EmbeddedLevel& level);
+    void close();
+
+    const void*         get_layer(int layer) const;
+    bool                get_rle_layer(int layer, RleTileLayer& tiles) const;
+    size_t              get_dense_layer_size() const;
+    const LevelSpawn*   get_spawns() const;
+    const LevelSpawn*   find_spawn(uint32_t entity_type, int index = 0) const;
+    glm::vec3           get_spawn_position(uint32_t entity_type, int index = 0) const;
+
+    const LevelChunk*    get_chunks() const;
+    const unsigned char* get_vertex_data() const;
+    const unsigned char* get_occluder_data() const;
+    const uint32_t*      get_solid_mask() const;
+
+    bool  const is_open()          const { return m_data != NULL || is_embedded(); }
+    bool  const is_embedded()      const { return m_embedded.tiles != NULL; }
+    int   const get_width()        const { return (int)m_header.width; }
+    int   const get_height()       const { return (int)m_header.height; }
+    float const get_tile_size()    const { return m_header.tile_size; }
+    int   const get_tile_count_x() const { return (int)m_header.tile_count_x; }
+    int   const get_tile_count_y() const { return (int)m_header.tile_count_y; }
+    int   const get_layer_count()  const { return (int)m_header.layer_count; }
+    bool  const is_rle()           const { return m_header.layer_encoding == LEVEL_LAYERS_RLE; }
+    int   const get_tile_index_size() const { return (int)m_header.tile_index_size; }
+    int   const get_spawn_count()  const { return (int)m_header.spawn_count; }
+    int   const get_chunk_size()   const { return (int)m_header.chunk_size; }
+    bool  const is_baked()         const { return m_header.chunk_size != 0; }
+
+    const unsigned char*        const get_data()     const { return m_data; }
+    std::shared_ptr<MappedFile> const get_file()     const { return m_file; }
+    const EmbeddedLevel*        const get_embedded() const { return is_embedded() ? &m_embedded : NULL; }
+};
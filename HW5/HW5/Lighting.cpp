@@ -0,0 +1,247 @@
+#include "Lighting.h"
+#include "Benchmark.h"
+#include "RenderBackend.h"
+#include "Transform2D.h"
+#include "glm/gtc/constants.hpp"
+#include <algorithm>
+#include <cmath>
+
+Lighting::Lighting()
+{
+    set_ambient_colour(glm::vec4(0.35f, 0.35f, 0.45f, 1.0f));
+}
+
+/*
+* The angle bin an angle falls in, counted on from the bin at -pi without
+* wrapping -- take it mod bin_count to use it
+*
+* @param angle, in radians
+* @param bin_count, how many bins the circle is split into
+*/
+int Lighting::get_angle_bin(float angle, int bin_count) const
+{
+    return (int)floorf((angle + glm::pi<float>()) / (2.0f * glm::pi<float>()) * bin_count);
+}
+
+/*
+* The angles a ray from the centre can be at and still hit an edge, counting
+* the slack the hit test gives past its ends
+* Returns false if the edge runs (almost) through the centre, so any ray might hit it
+*
+* @param edge, the edge
+* @param centre, where the rays come from
+* @param low, set to where the span starts
+* @param high, set to where the span ends -- more than low, and by at most a little over pi
+*/
+bool Lighting::get_edge_span(const OccluderEdge& edge, glm::vec2 centre, float& low, float& high) const
+{
+    glm::vec2 segment = edge.end - edge.start;
+    glm::vec2 start = edge.start - segment * LIGHTING_EDGE_SLACK - centre;
+    glm::vec2 end = edge.end + segment * LIGHTING_EDGE_SLACK - centre;
+
+    // the closest point of the edge to the centre
+    glm::vec2 along = end - start;
+    float fraction = glm::clamp(-glm::dot(start, along) / glm::max(glm::dot(along, along), 1e-12f), 0.0f, 1.0f);
+    glm::vec2 closest = start + along * fraction;
+    if (glm::dot(closest, closest) < 1e-6f) return false;
+
+    float start_angle = atan2f(start.y, start.x);
+    float end_angle = atan2f(end.y, end.x);
+
+    // the short way round, anticlockwise
+    if (start.x * end.y - start.y * end.x < 0.0f) std::swap(start_angle, end_angle);
+    if (end_angle < start_angle) end_angle += 2.0f * glm::pi<float>();
+
+    low = start_angle - LIGHTING_SPAN_PADDING;
+    high = end_angle + LIGHTING_SPAN_PADDING;
+    return true;
+}
+
+/*
+* Sorts m_edges into angle bins around the centre, each edge into every bin
+* its span touches -- a bin per edge, so most bins only hold a few
+*
+* @param centre, where the rays come from
+*/
+void Lighting::bin_edges(glm::vec2 centre)
+{
+    int bin_count = glm::clamp((int)m_edges.size(), 1, LIGHTING_MAX_ANGLE_BINS);
+
+    // counted first, then filled, so each bin's edges sit together
+    m_bin_starts.assign(bin_count + 1, 0);
+    m_bin_edges.clear();
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int i = 0; i < (int)m_edges.size(); i++)
+        {
+            float low, high;
+            int first_bin = 0;
+            int last_bin = bin_count - 1;
+            if (get_edge_span(m_edges[i], centre, low, high))
+            {
+                first_bin = get_angle_bin(low, bin_count);
+                last_bin = glm::min(get_angle_bin(high, bin_count), first_bin + bin_count - 1);
+            }
+
+            for (int bin = first_bin; bin <= last_bin; bin++)
+            {
+                int wrapped = ((bin % bin_count) + bin_count) % bin_count;
+                if (pass == 0) m_bin_starts[wrapped + 1]++;
+                else m_bin_edges[m_bin_starts[wrapped + 1]++] = i;
+            }
+        }
+
+        if (pass == 0)
+        {
+            for (int bin = 0; bin < bin_count; bin++) m_bin_starts[bin + 1] += m_bin_starts[bin];
+            m_bin_edges.resize(m_bin_starts[bin_count]);
+
+            // filling moves each start on by one bin, so shift them back a bin first
+            for (int bin = bin_count; bin > 0; bin--) m_bin_starts[bin] = m_bin_starts[bin - 1];
+            m_bin_starts[0] = 0;
+        }
+    }
+}
+
+/*
+* Sweeps rays around a light and builds its visibility polygon as a
+* triangle fan -- each triangle is a quad with its last corner repeated,
+* so it goes through the same quad draws as everything else
+* The light's square bounds are added as edges so every ray hits something
+*
+* @param light, the light to sweep around
+* @param map, where the occluder edges come from
+*/
+void Lighting::build_visibility(const PointLight& light, Map* map)
+{
+    glm::vec2 centre = light.position;
+    glm::vec2 low = centre - glm::vec2(light.radius);
+    glm::vec2 high = centre + glm::vec2(light.radius);
+
+    m_edges.clear();
+    map->get_occluders(low, high, m_edges);
+    m_edges.push_back({ glm::vec2(low.x, low.y),   glm::vec2(high.x, low.y) });
+    m_edges.push_back({ glm::vec2(high.x, low.y),  glm::vec2(high.x, high.y) });
+    m_edges.push_back({ glm::vec2(high.x, high.y), glm::vec2(low.x, high.y) });
+    m_edges.push_back({ glm::vec2(low.x, high.y),  glm::vec2(low.x, low.y) });
+
+    // shared ends of merged edges give the same angles, so sort and drop repeats
+    m_angles.clear();
+    for (const OccluderEdge& edge : m_edges)
+    {
+        float start_angle = atan2f(edge.start.y - centre.y, edge.start.x - centre.x);
+        float end_angle = atan2f(edge.end.y - centre.y, edge.end.x - centre.x);
+        m_angles.insert(m_angles.end(), {
+            start_angle - LIGHTING_ANGLE_OFFSET, start_angle, start_angle + LIGHTING_ANGLE_OFFSET,
+            end_angle - LIGHTING_ANGLE_OFFSET,   end_angle,   end_angle + LIGHTING_ANGLE_OFFSET
+            });
+    }
+    std::sort(m_angles.begin(), m_angles.end());
+    m_angles.erase(std::unique(m_angles.begin(), m_angles.end()), m_angles.end());
+
+    bin_edges(centre);
+    int bin_count = (int)m_bin_starts.size() - 1;
+
+    m_polygon.clear();
+    for (float angle : m_angles)
+    {
+        glm::vec2 direction(cosf(angle), sinf(angle));
+        float closest = light.radius * 2.0f;
+
+        // only the edges whose span covers this angle can be hit
+        int bin = ((get_angle_bin(angle, bin_count) % bin_count) + bin_count) % bin_count;
+        for (int i = m_bin_starts[bin]; i < m_bin_starts[bin + 1]; i++)
+        {
+            const OccluderEdge& edge = m_edges[m_bin_edges[i]];
+
+            // centre + direction * t == edge.start + segment * s
+            glm::vec2 segment = edge.end - edge.start;
+            float denominator = direction.x * segment.y - direction.y * segment.x;
+            if (fabs(denominator) < 1e-8f) continue;
+
+            glm::vec2 offset = edge.start - centre;
+            float t = (offset.x * segment.y - offset.y * segment.x) / denominator;
+            float s = (offset.x * direction.y - offset.y * direction.x) / denominator;
+
+            // a little slack on s, so rays straight at a corner don't slip between its two edges
+            if (t >= 0.0f && t < closest && s >= -LIGHTING_EDGE_SLACK && s <= 1.0f + LIGHTING_EDGE_SLACK) closest = t;
+        }
+
+        m_polygon.push_back(centre + direction * closest);
+    }
+
+    m_vertices.clear();
+    int corner_count = (int)m_polygon.size();
+    for (int i = 0; i < corner_count; i++)
+    {
+        glm::vec2 first = m_polygon[i];
+        glm::vec2 second = m_polygon[(i + 1) % corner_count];
+        m_vertices.insert(m_vertices.end(), {
+            centre.x, centre.y,
+            first.x,  first.y,
+            second.x, second.y,
+            second.x, second.y
+            });
+    }
+
+    m_last_edge_count += (int)m_edges.size() - 4;
+    m_last_ray_count += corner_count;
+}
+
+/*
+* Draws every light into the light buffer, added on top of the ambient colour
+* Done before the scene, since switching framebuffers flushes the render queue
+*
+* @param map, the map casting the shadows
+*/
+void Lighting::render_lights(Map* map)
+{
+    RenderTimer timer(RENDER_LIGHTING);
+
+    m_last_edge_count = 0;
+    m_last_ray_count = 0;
+    if (m_program == NULL) return;
+
+    // lights move every frame, so the buffer is always redrawn
+    m_light_buffer.invalidate();
+    m_light_buffer.begin(m_program, 0);
+
+    // polygons are already in world space
+    m_program->set_model_transform(Transform2D());
+
+    RenderBackend* backend = RenderBackend::get();
+    backend->set_blend_mode(BLEND_ADDITIVE);
+
+    for (const PointLight& light : m_lights)
+    {
+        build_visibility(light, map);
+
+        m_program->set_colour(light.colour.r, light.colour.g, light.colour.b, light.colour.a);
+        m_program->set_uniform_vec2("lightPosition", light.position.x, light.position.y);
+        m_program->set_uniform_float("lightRadius", light.radius);
+
+        backend->set_attribute(m_program->get_position_attribute(), 2, GL_FLOAT, false, 2 * sizeof(float), m_vertices.data());
+        backend->draw_quads((int)m_vertices.size() / 8);
+    }
+
+    backend->disable_attribute(m_program->get_position_attribute());
+    backend->set_blend_mode(BLEND_ALPHA);
+
+    m_light_buffer.end();
+}
+
+/*
+* Multiplies the light buffer over everything drawn so far
+* Goes on its own layer below the text, so through the render queue the text stays unlit
+*
+* @param program, the textured SHADERPROGRAM
+*/
+void Lighting::composite(ShaderProgram* program)
+{
+    RenderTimer timer(RENDER_LIGHTING);
+
+    if (m_program == NULL) return;
+
+    RenderBackend::get()->set_layer(RENDER_LAYER_LIGHTING);
+    m_light_buffer.present(program, BLEND_MULTIPLY);
+}
@@ -0,0 +1,87 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+
+#define GL_GLEXT_PROTOTYPES 1
+#include <vector>
+#include <SDL_opengl.h>
+#include "glm/mat4x4.hpp"
+#include "ShaderProgram.h"
+#include "RenderCache.h"
+#include "Map.h"
+
+#define LIGHTING_ANGLE_OFFSET 0.0001f // radians -- extra rays either side of an edge end, to see past corners
+#define LIGHTING_EDGE_SLACK   0.0001f // how far past its ends, as a fraction of its length, a ray still hits an edge
+#define LIGHTING_SPAN_PADDING 0.001f  // radians -- widens every edge's span, so float error never leaves a hit edge out
+#define LIGHTING_MAX_ANGLE_BINS 1024
+
+// a round light, fading out to nothing at its radius
+struct PointLight
+{
+    glm::vec2 position;
+    float     radius;
+    glm::vec4 colour; // rgb, and the intensity in a
+};
+
+/*
+* 2D lights that the map's solid tiles cast shadows from
+*
+*   lighting.clear_lights();
+*   lighting.add_light(...);
+*   lighting.render_lights(map);      // into the light buffer, before the scene
+*   ... draw the scene ...
+*   lighting.composite(program);      // multiplies the light buffer over it
+*
+* Each light's visibility polygon comes from an angular sweep -- a ray towards
+* every end of the occluder edges near it (and just either side, to see past
+* corners), joining the closest hits in angle order. The edges come from
+* Map::get_occluders, so nothing is extracted from the tiles per frame.
+* Edges are sorted into bins by the angles they cover, and a ray is only
+* tested against the edges in its bin. That is about E rays against a few
+* edges each, rather than every ray against all E, but it is still E^2 if
+* every edge covers most of the circle (a light boxed in right next to a lot of them).
+* Polygons are added up in a light buffer cleared to the ambient colour.
+*/
+class Lighting
+{
+private:
+    ShaderProgram* m_program = NULL; // the light shaders
+    RenderCache    m_light_buffer;
+
+    std::vector<PointLight> m_lights;
+
+    // reused every light so the sweep doesn't allocate
+    std::vector<OccluderEdge> m_edges;
+    std::vector<float>        m_angles;
+    std::vector<int>          m_bin_starts; // where each angle bin's edges start in m_bin_edges, plus the end
+    std::vector<int>          m_bin_edges;
+    std::vector<glm::vec2>    m_polygon;
+    std::vector<float>        m_vertices;
+
+    int m_last_edge_count = 0;
+    int m_last_ray_count = 0;
+
+    int  get_angle_bin(float angle, int bin_count) const;
+    bool get_edge_span(const OccluderEdge& edge, glm::vec2 centre, float& low, float& high) const;
+    void bin_edges(glm::vec2 centre);
+    void build_visibility(const PointLight& light, Map* map);
+
+public:
+    Lighting();
+
+    void set_program(ShaderProgram* program) { m_program = program; }
+    void set_ambient_colour(const glm::vec4& colour) { m_light_buffer.set_clear_colour(colour); }
+
+    void clear_lights() { m_lights.clear(); }
+    void add_light(const PointLight& light) { m_lights.push_back(light); }
+
+    void render_lights(Map* map);
+    void composite(ShaderProgram* program);
+
+    int const get_light_count()     const { return (int)m_lights.size(); }
+    int const get_last_edge_count() const { return m_last_edge_count; }
+    int const get_last_ray_count()  const { return m_last_ray_count; }
+};
@@ -1,10 +1,14 @@
 #include "Scene.h"
+#include "RenderCache.h"
 
 class MainMenu : public Scene {
 public:
     //  STATIC ATTRIBUTES  //
     int ENEMY_COUNT = 1;
 
+    //  ATTRIBUTES  //
+    RenderCache m_render_cache; // nothing on this screen moves
+
     //  CONSTRUCTOR  //
     ~MainMenu();
 
@@ -12,4 +16,6 @@ public:
     void initialise() override;
     void update(float delta_time) override;
     void render(ShaderProgram* program) override;
+    const char*   get_level_filepath() const override;
+    EmbeddedLevel get_embedded_level() const override;
 };
\ No newline at end of file
@@ -1,70 +1,146 @@
 
 #include "Map.h"
+#include "Utility.h"
+#include "Benchmark.h"
+#include "RenderBackend.h"
+#include <algorithm>
+
+// baked level files store these as they are
+static_assert(sizeof(TileVertex) == 8, "TileVertex is 8 bytes in level files");
+static_assert(sizeof(OccluderEdge) == 16, "OccluderEdge is 16 bytes in level files");
+
+// copies count tile ids stored as T, so the copy loop is compiled once per id size
+template <typename T>
+static void read_level_row(const void* level_data, size_t first, int count, unsigned int* tiles)
+{
+	std::copy_n((const T*)level_data + first, count, tiles);
+}
+
+MapRenderMode  Map::s_render_mode = MAP_RENDER_MESH;
+ShaderProgram* Map::s_tile_array_program = NULL;
+ShaderProgram* Map::s_tilemap_program = NULL;
+float          Map::s_animation_time = 0.0f;
+unsigned int   Map::s_animation_step = 0;
 
 /*
 * Map Constructor Override
 */
-Map::Map(int width, int height, unsigned int* level_data, GLuint texture_id, float tile_size, int tile_count_x, int tile_count_y)
+Map::Map(int width, int height, const unsigned int* level_data, GLuint texture_id, GLuint array_texture_id,
+	float tile_size, int tile_count_x, int tile_count_y)
+{
+	initialise(width, height, level_data, sizeof(unsigned int), texture_id, array_texture_id, tile_size, tile_count_x, tile_count_y);
+	compute_bounds();
+	build();
+}
+
+/*
+* Builds a map over the first tile layer of a level file, without copying it
+* Run-length encoded layers stay encoded and are decoded a row at a time
+* A compiled or built-in level's meshes, occluders and solidity mask, and a built-in level's bounds, are used as they are
+*
+* @param level, an open level -- the map keeps its mapping, so the level can be closed afterwards
+*/
+Map::Map(const LevelFile& level, GLuint texture_id, GLuint array_texture_id)
+{
+	initialise(level.get_width(), level.get_height(), level.get_layer(0), level.get_tile_index_size(), texture_id, array_texture_id,
+		level.get_tile_size(), level.get_tile_count_x(), level.get_tile_count_y());
+	level.get_rle_layer(0, m_rle_tiles);
+	m_level_file = level.get_file();
+
+	// the solidity mask doesn't depend on the chunk size, but meshes baked for another size are built here instead
+	m_solid_mask = level.get_solid_mask();
+	if (level.is_baked() && level.get_chunk_size() == MAP_CHUNK_SIZE)
+	{
+		m_baked_vertex_data = level.get_vertex_data();
+		m_baked_occluder_data = level.get_occluder_data();
+		m_baked_chunks = level.get_chunks();
+	}
+
+	const EmbeddedLevel* embedded = level.get_embedded();
+	if (embedded == NULL) compute_bounds();
+	else
+	{
+		m_left_bound = embedded->left_bound;
+		m_right_bound = embedded->right_bound;
+		m_top_bound = embedded->top_bound;
+		m_bottom_bound = embedded->bottom_bound;
+	}
+
+	build();
+}
+
+void Map::initialise(int width, int height, const void* level_data, int tile_index_size, GLuint texture_id, GLuint array_texture_id,
+	float tile_size, int tile_count_x, int tile_count_y)
 {
 	m_width = width;
 	m_height = height;
 
 	m_level_data = level_data;
+	m_tile_index_size = tile_index_size;
+	switch (tile_index_size)
+	{
+	case 1:  m_read_level_row = read_level_row<uint8_t>; break;
+	case 2:  m_read_level_row = read_level_row<uint16_t>; break;
+	default: m_read_level_row = read_level_row<uint32_t>; break;
+	}
 	m_texture_id = texture_id;
+	m_array_texture_id = array_texture_id;
 
 	m_tile_size = tile_size;
 	m_tile_count_x = tile_count_x;
 	m_tile_count_y = tile_count_y;
+	m_tile_animations.resize(tile_count_x * tile_count_y);
 
-	build();
+	m_solid_mask_stride = (width + 31) / 32;
 }
 
-void Map::build()
+/*
+* Map Destructor
+* Stops the background chunk builder before the chunks it writes into go away
+*/
+Map::~Map()
 {
-	// maps out tiles in the y
-	for (int y_coord = 0; y_coord < m_height; y_coord++)
 	{
-		// maps out tiles in the x
-		for (int x_coord = 0; x_coord < m_width; x_coord++)
-		{
-			// current tile
-			int tile = m_level_data[y_coord * m_width + x_coord];
+		std::lock_guard<std::mutex> lock(m_chunk_mutex);
+		m_chunk_worker_running = false;
+	}
+	m_chunk_condition.notify_all();
 
-			// EMPTY TILES/AIR ARE DENOTED AS 0
-			if (tile == 0) continue;
-
-			float u_coord = (float)(tile % m_tile_count_x) / (float)m_tile_count_x;
-			float v_coord = (float)(tile / m_tile_count_x) / (float)m_tile_count_y;
-
-			// dimensions of each tile and its position
-			float tile_width = 1.0f / (float)m_tile_count_x;
-			float tile_height = 1.0f / (float)m_tile_count_y;
-
-			// get radius
-			float x_offset = -(m_tile_size / 2);
-			float y_offset = (m_tile_size / 2);
-
-			// store updated / calculated vertices and textures 
-			m_vertices.insert(m_vertices.end(), {
-				x_offset + (m_tile_size * x_coord),  y_offset + -m_tile_size * y_coord,
-				x_offset + (m_tile_size * x_coord),  y_offset + (-m_tile_size * y_coord) - m_tile_size,
-				x_offset + (m_tile_size * x_coord) + m_tile_size, y_offset + (-m_tile_size * y_coord) - m_tile_size,
-				x_offset + (m_tile_size * x_coord), y_offset + -m_tile_size * y_coord,
-				x_offset + (m_tile_size * x_coord) + m_tile_size, y_offset + (-m_tile_size * y_coord) - m_tile_size,
-				x_offset + (m_tile_size * x_coord) + m_tile_size, y_offset + -m_tile_size * y_coord
-				});
+	if (m_chunk_worker.joinable()) m_chunk_worker.join();
 
-			m_texture_coordinates.insert(m_texture_coordinates.end(), {
-				u_coord, v_coord,
-				u_coord, v_coord + (tile_height),
-				u_coord + tile_width, v_coord + (tile_height),
-				u_coord, v_coord,
-				u_coord + tile_width, v_coord + (tile_height),
-				u_coord + tile_width, v_coord
-				});
+	if (m_tile_index_texture_id != 0) glDeleteTextures(1, &m_tile_index_texture_id);
+	if (m_tile_animation_texture_id != 0) glDeleteTextures(1, &m_tile_animation_texture_id);
+}
+
+/*
+* Splits the map into MAP_CHUNK_SIZE x MAP_CHUNK_SIZE chunks
+* No meshes or occluder edges are made here -- stream_chunks() builds meshes and
+* get_occluders() edges, for the chunks they reach, so a compiled level loads
+* without reading more of its file than it has to
+*/
+void Map::build()
+{
+	m_chunk_count_x = (m_width + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE;
+	m_chunk_count_y = (m_height + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE;
+
+	if (m_solid_mask == NULL) build_sparse_tiles(m_tile_index_size);
+
+	m_chunks.clear();
+	m_chunks.resize(m_chunk_count_x * m_chunk_count_y);
+	for (int chunk_y = 0; chunk_y < m_chunk_count_y; chunk_y++)
+	{
+		for (int chunk_x = 0; chunk_x < m_chunk_count_x; chunk_x++)
+		{
+			MapChunk& chunk = m_chunks[chunk_y * m_chunk_count_x + chunk_x];
+			chunk.chunk_x = chunk_x;
+			chunk.chunk_y = chunk_y;
 		}
 	}
+}
 
+// built-in levels come with these worked out already (see make_embedded_level)
+void Map::compute_bounds()
+{
 	// MAKE SURE TO UPDATE BOUNDS IF SIZE OF TILES CHANGES
 	m_left_bound = 0 - (m_tile_size / 2);
 	m_right_bound = (m_tile_size * m_width) - (m_tile_size / 2);
@@ -72,26 +148,657 @@ void Map::build()
 	m_bottom_bound = -(m_tile_size * m_height) + (m_tile_size / 2);
 }
 
-void Map::render(ShaderProgram* program)
+/*
+* Builds the mesh for a single chunk
+* Greedy meshing -- each quad grows right along a run of the same tile,
+* then down for as long as every row below repeats that run
+* Positions are in whole tiles relative to the chunk origin, the chunk's
+* place in the world and the tile size are applied by the model matrix
+* Only reads the level data, so it is safe to call from the chunk worker
+* as long as is_baked was read under m_chunk_mutex, which guards what it depends on
+*
+* @param chunk_x, chunk_y, position of the chunk in the chunk grid
+* @param is_baked, is_baked() taken by the caller
+* @param vertices, output vector for the chunk mesh
+*/
+void Map::build_chunk(int chunk_x, int chunk_y, bool is_baked, std::vector<TileVertex>& vertices)
+{
+	if (is_baked)
+	{
+		const LevelChunk& baked = m_baked_chunks[chunk_y * m_chunk_count_x + chunk_x];
+		const TileVertex* baked_vertices = (const TileVertex*)(m_baked_vertex_data + baked.vertex_offset);
+		vertices.assign(baked_vertices, baked_vertices + baked.vertex_count);
+		return;
+	}
+
+	// set_tile() may be adding chunks to m_sparse_tiles, and set_tile_animation() changing m_tile_animations
+	std::lock_guard<std::mutex> lock(m_tile_mutex);
+
+	int first_x = chunk_x * MAP_CHUNK_SIZE;
+	int first_y = chunk_y * MAP_CHUNK_SIZE;
+	int chunk_width = std::min(first_x + MAP_CHUNK_SIZE, m_width) - first_x;
+	int chunk_height = std::min(first_y + MAP_CHUNK_SIZE, m_height) - first_y;
+
+	// tile set layer of every tile in the chunk, 0 when the tile is empty or already meshed
+	// ids past the end of the tile set wrap around, the same way GL_REPEAT wraps them
+	int layer_count = m_tile_count_x * m_tile_count_y;
+	int layers[MAP_CHUNK_SIZE][MAP_CHUNK_SIZE];
+	bool has_tile[MAP_CHUNK_SIZE][MAP_CHUNK_SIZE];
+	unsigned int row[MAP_CHUNK_SIZE];
+	for (int y = 0; y < chunk_height; y++)
+	{
+		read_row(first_y + y, first_x, chunk_width, row);
+		for (int x = 0; x < chunk_width; x++)
+		{
+			int tile = row[x];
+
+			// EMPTY TILES/AIR ARE DENOTED AS 0
+			has_tile[y][x] = tile != 0;
+			layers[y][x] = tile % layer_count;
+		}
+	}
+
+	for (int y = 0; y < chunk_height; y++)
+	{
+		for (int x = 0; x < chunk_width; x++)
+		{
+			if (!has_tile[y][x]) continue;
+			int layer = layers[y][x];
+
+			// grow right
+			int run_width = 1;
+			while (x + run_width < chunk_width && has_tile[y][x + run_width] && layers[y][x + run_width] == layer) run_width++;
+
+			// grow down while the whole run repeats
+			int run_height = 1;
+			while (y + run_height < chunk_height)
+			{
+				bool row_matches = true;
+				for (int i = 0; i < run_width && row_matches; i++)
+				{
+					row_matches = has_tile[y + run_height][x + i] && layers[y + run_height][x + i] == layer;
+				}
+				if (!row_matches) break;
+				run_height++;
+			}
+
+			for (int j = 0; j < run_height; j++)
+			{
+				for (int i = 0; i < run_width; i++) has_tile[y + j][x + i] = false;
+			}
+
+			// quad corners -- y goes negative as the array goes down
+			GLshort left = (GLshort)x;
+			GLshort right = (GLshort)(x + run_width);
+			GLshort top = (GLshort)-y;
+			GLshort bottom = (GLshort)-(y + run_height);
+
+			// every vertex carries the tile's animation, the shader advances the layer
+			GLubyte frame_count = m_tile_animations[layer].frame_count;
+			GLubyte frame_rate = m_tile_animations[layer].frame_rate;
+
+			// top left, bottom left, bottom right, top right
+			vertices.insert(vertices.end(), {
+				{ left,  top,    (GLshort)layer, frame_count, frame_rate },
+				{ left,  bottom, (GLshort)layer, frame_count, frame_rate },
+				{ right, bottom, (GLshort)layer, frame_count, frame_rate },
+				{ right, top,    (GLshort)layer, frame_count, frame_rate }
+				});
+		}
+	}
+}
+
+// tiles outside the map count as empty
+bool Map::has_tile(int x, int y) const
+{
+	if (x < 0 || x >= m_width)  return false;
+	if (y < 0 || y >= m_height) return false;
+	return is_solid_tile(x, y);
+}
+
+/*
+* Baked meshes only hold until the level is edited or a tile starts animating,
+* since the vertices carry each tile's animation
+* Both only change under m_chunk_mutex, so that's the lock to read this under
+*/
+bool Map::is_baked() const
+{
+	return m_baked_chunks != NULL && !m_is_edited && m_animated_tile_count == 0;
+}
+
+/*
+* Copies the level's non-empty chunks into m_sparse_tiles, which everything
+* reads from afterwards -- a big level that is mostly air only keeps the
+* chunks with something in them
+* Tile lookups from collisions and occluders find the chunk through a hash,
+* and usually don't even do that since the last chunk is remembered
+* Also used to copy the copy when an edit needs wider tile ids
+*
+* @param index_size, bytes per tile id in the copy, 1, 2 or 4
+*/
+void Map::build_sparse_tiles(int index_size)
+{
+	std::unique_ptr<SparseTileLayer> tiles = SparseTileLayer::create(index_size, m_width, m_height);
+
+	std::vector<unsigned int> row(m_width);
+	for (int y = 0; y < m_height; y++)
+	{
+		read_row(y, 0, m_width, row.data());
+		tiles->set_row(y, row.data());
+	}
+
+	std::lock_guard<std::mutex> lock(m_tile_mutex);
+	m_sparse_tiles = std::move(tiles);
+	m_solid_mask = NULL;
+}
+
+/*
+* Copies part of a row of tile ids, decoding it if the level is run-length encoded
+* Only reads the level data, so it is safe to call from the chunk worker while it holds m_tile_mutex
+*
+* @param y, the row
+* @param first_x, count, which tiles of the row
+* @param tiles, count tile ids out
+*/
+void Map::read_row(int y, int first_x, int count, unsigned int* tiles) const
+{
+	if (m_sparse_tiles != NULL) m_sparse_tiles->read_row(y, first_x, count, tiles);
+	else if (m_level_data != NULL) m_read_level_row(m_level_data, (size_t)y * m_width + first_x, count, tiles);
+	else m_rle_tiles.read_row(y, first_x, count, tiles);
+}
+
+/*
+* The id of one tile, 0 outside the map
+* Run-length encoded levels only decode the row the tile is in, and both
+* they and the map's own copy cache the last lookups, so this is for the main thread only
+*
+* @param x, y, tile position in the level array
+*/
+unsigned int Map::get_tile(int x, int y) const
+{
+	if (x < 0 || x >= m_width)  return 0;
+	if (y < 0 || y >= m_height) return 0;
+
+	if (m_sparse_tiles != NULL) return m_sparse_tiles->get_tile(x, y);
+	if (m_level_data == NULL) return m_rle_tiles.get_tile(x, y);
+
+	unsigned int tile;
+	m_read_level_row(m_level_data, (size_t)y * m_width + x, 1, &tile);
+	return tile;
+}
+
+/*
+* @return bytes the tile ids and the solidity mask take up, mapped or not -- meshes aren't counted
+* The map's own copy keeps its solid bits with each chunk, a baked level has a bit for every tile
+*/
+size_t const Map::get_tile_byte_count() const
+{
+	if (m_sparse_tiles != NULL) return m_sparse_tiles->get_byte_count();
+
+	size_t mask_bytes = (size_t)m_solid_mask_stride * m_height * sizeof(uint32_t);
+	if (m_level_data != NULL) return (size_t)m_width * m_height * m_tile_index_size + mask_bytes;
+	return m_rle_tiles.get_byte_count() + mask_bytes;
+}
+
+/*
+* Finds the sides of the chunk's solid tiles that face an empty tile
+* Neighbouring exposed sides along a row or column are merged into one edge,
+* so a flat floor is a single segment however long it is
+* Edges never cross into the next chunk, so each one belongs to exactly one chunk
+*
+* @param chunk, the chunk to (re)build the occluders of
+*/
+void Map::build_occluders(MapChunk& chunk)
+{
+	int first_x = chunk.chunk_x * MAP_CHUNK_SIZE;
+	int first_y = chunk.chunk_y * MAP_CHUNK_SIZE;
+	int last_x = std::min(first_x + MAP_CHUNK_SIZE, m_width);
+	int last_y = std::min(first_y + MAP_CHUNK_SIZE, m_height);
+	float half_tile = m_tile_size / 2;
+
+	chunk.occluders.clear();
+
+	// tops and bottoms, merged along each row
+	for (int y = first_y; y < last_y; y++)
+	{
+		for (int side = -1; side <= 1; side += 2)
+		{
+			float edge_y = -(y * m_tile_size) - (side * half_tile); // y goes negative as the array goes down
+			int run_start = -1;
+			for (int x = first_x; x <= last_x; x++)
+			{
+				bool is_exposed = x < last_x && has_tile(x, y) && !has_tile(x, y + side);
+				if (is_exposed && run_start < 0) run_start = x;
+				if (is_exposed || run_start < 0) continue;
+
+				chunk.occluders.push_back({ glm::vec2(run_start * m_tile_size - half_tile, edge_y), glm::vec2(x * m_tile_size - half_tile, edge_y) });
+				run_start = -1;
+			}
+		}
+	}
+
+	// left and right sides, merged down each column
+	for (int x = first_x; x < last_x; x++)
+	{
+		for (int side = -1; side <= 1; side += 2)
+		{
+			float edge_x = (x * m_tile_size) + (side * half_tile);
+			int run_start = -1;
+			for (int y = first_y; y <= last_y; y++)
+			{
+				bool is_exposed = y < last_y && has_tile(x, y) && !has_tile(x + side, y);
+				if (is_exposed && run_start < 0) run_start = y;
+				if (is_exposed || run_start < 0) continue;
+
+				chunk.occluders.push_back({ glm::vec2(edge_x, -(run_start * m_tile_size) + half_tile), glm::vec2(edge_x, -(y * m_tile_size) + half_tile) });
+				run_start = -1;
+			}
+		}
+	}
+}
+
+/*
+* A chunk's occluders, worked out the first time they are asked for, so loading a
+* level never touches the chunks no light comes near
+* A compiled level's are copied out of the file, unless a tile has been changed since
+*
+* @param chunk, the chunk the edges belong to
+*/
+const std::vector<OccluderEdge>& Map::get_chunk_occluders(MapChunk& chunk)
+{
+	if (chunk.has_occluders) return chunk.occluders;
+
+	if (m_baked_chunks != NULL && !m_is_edited)
+	{
+		const LevelChunk& baked = m_baked_chunks[chunk.chunk_y * m_chunk_count_x + chunk.chunk_x];
+		const OccluderEdge* occluders = (const OccluderEdge*)(m_baked_occluder_data + baked.occluder_offset);
+		chunk.occluders.assign(occluders, occluders + baked.occluder_count);
+	}
+	else build_occluders(chunk);
+
+	chunk.has_occluders = true;
+	return chunk.occluders;
+}
+
+/*
+* Collects the occluder edges near an area, using the chunk grid as the spatial index
+* Only chunks overlapping the area are looked at, and only edges whose bounds overlap it are kept
+*
+* @param min, max, corners of the area in world units
+* @param edges, output vector the edges are appended to
+*/
+void Map::get_occluders(glm::vec2 min, glm::vec2 max, std::vector<OccluderEdge>& edges)
+{
+	float half_tile = m_tile_size / 2;
+
+	// Our array counts up as Y goes down, so the top of the area is the first row.
+	int first_chunk_x = std::max((int)floor((min.x + half_tile) / m_tile_size) / MAP_CHUNK_SIZE, 0);
+	int last_chunk_x = std::min((int)floor((max.x + half_tile) / m_tile_size) / MAP_CHUNK_SIZE, m_chunk_count_x - 1);
+	int first_chunk_y = std::max((int)floor((-max.y + half_tile) / m_tile_size) / MAP_CHUNK_SIZE, 0);
+	int last_chunk_y = std::min((int)floor((-min.y + half_tile) / m_tile_size) / MAP_CHUNK_SIZE, m_chunk_count_y - 1);
+
+	for (int chunk_y = first_chunk_y; chunk_y <= last_chunk_y; chunk_y++)
+	{
+		for (int chunk_x = first_chunk_x; chunk_x <= last_chunk_x; chunk_x++)
+		{
+			for (const OccluderEdge& edge : get_chunk_occluders(m_chunks[chunk_y * m_chunk_count_x + chunk_x]))
+			{
+				if (std::max(edge.start.x, edge.end.x) < min.x || std::min(edge.start.x, edge.end.x) > max.x) continue;
+				if (std::max(edge.start.y, edge.end.y) < min.y || std::min(edge.start.y, edge.end.y) > max.y) continue;
+				edges.push_back(edge);
+			}
+		}
+	}
+}
+
+/*
+* Background thread that builds queued chunks
+* The finished mesh is only handed over if the chunk is still wanted
+*/
+void Map::chunk_worker()
+{
+	std::unique_lock<std::mutex> lock(m_chunk_mutex);
+	while (true)
+	{
+		m_chunk_condition.wait(lock, [this] { return !m_chunk_queue.empty() || !m_chunk_worker_running; });
+		if (!m_chunk_worker_running) break;
+
+		int chunk_index = m_chunk_queue.front();
+		m_chunk_queue.pop_front();
+		int chunk_x = m_chunks[chunk_index].chunk_x;
+		int chunk_y = m_chunks[chunk_index].chunk_y;
+		unsigned int revision = m_chunks[chunk_index].revision;
+		bool is_chunk_baked = is_baked();
+
+		// build without holding the lock so the main thread can keep rendering
+		// baked meshes stay right for every chunk whose revision hasn't moved, and the rest are retried below
+		lock.unlock();
+		std::vector<TileVertex> vertices;
+		build_chunk(chunk_x, chunk_y, is_chunk_baked, vertices);
+		lock.lock();
+
+		// chunk may have been evicted or built by the main thread in the meantime
+		MapChunk& chunk = m_chunks[chunk_index];
+		if (chunk.state != CHUNK_QUEUED) continue;
+
+		// a tile was edited while building -- try again with the new data
+		if (chunk.revision != revision)
+		{
+			m_chunk_queue.push_back(chunk_index);
+			continue;
+		}
+
+		chunk.vertices.swap(vertices);
+		chunk.state = CHUNK_LOADED;
+		m_revision++;
+	}
+}
+
+/*
+* Loads chunks near the camera and evicts the ones that are far away
+* Nearby chunks are built on the worker thread, but the chunk under the
+* camera is built right away since it is needed this frame
+*
+* @param camera_position, world position at the centre of the screen
+*/
+void Map::stream_chunks(glm::vec3 camera_position)
+{
+	int camera_chunk_x = (int)floor(((camera_position.x + (m_tile_size / 2)) / m_tile_size) / MAP_CHUNK_SIZE);
+	int camera_chunk_y = (int)floor(((-camera_position.y + (m_tile_size / 2)) / m_tile_size) / MAP_CHUNK_SIZE); // Our array counts up as Y goes down.
+
+	bool has_queued_chunks = false;
+	std::unique_lock<std::mutex> lock(m_chunk_mutex);
+
+	for (int i = 0; i < (int)m_chunks.size(); i++)
+	{
+		MapChunk& chunk = m_chunks[i];
+		int distance = std::max(abs(chunk.chunk_x - camera_chunk_x), abs(chunk.chunk_y - camera_chunk_y));
+
+		if (distance <= MAP_CHUNK_LOAD_RADIUS && chunk.state == CHUNK_UNLOADED)
+		{
+			chunk.state = CHUNK_QUEUED;
+			m_chunk_queue.push_back(i);
+			has_queued_chunks = true;
+		}
+		// one extra ring stays loaded so chunks don't thrash on a chunk border
+		else if (distance > MAP_CHUNK_LOAD_RADIUS + 1 && chunk.state != CHUNK_UNLOADED)
+		{
+			// not built yet, so the worker shouldn't build it only to throw it away
+			if (chunk.state == CHUNK_QUEUED) m_chunk_queue.erase(std::remove(m_chunk_queue.begin(), m_chunk_queue.end(), i), m_chunk_queue.end());
+
+			chunk.state = CHUNK_UNLOADED;
+			std::vector<TileVertex>().swap(chunk.vertices);
+			m_revision++;
+		}
+	}
+
+	if (camera_chunk_x >= 0 && camera_chunk_x < m_chunk_count_x &&
+		camera_chunk_y >= 0 && camera_chunk_y < m_chunk_count_y)
+	{
+		int camera_chunk = camera_chunk_y * m_chunk_count_x + camera_chunk_x;
+		MapChunk& chunk = m_chunks[camera_chunk];
+		if (chunk.state != CHUNK_LOADED)
+		{
+			build_chunk(chunk.chunk_x, chunk.chunk_y, is_baked(), chunk.vertices);
+			chunk.state = CHUNK_LOADED;
+			m_revision++;
+			m_chunk_queue.erase(std::remove(m_chunk_queue.begin(), m_chunk_queue.end(), camera_chunk), m_chunk_queue.end());
+			has_queued_chunks = !m_chunk_queue.empty();
+		}
+	}
+
+	if (!has_queued_chunks) return;
+
+	// worker only starts once a level is big enough to have chunks off screen
+	if (!m_chunk_worker_running)
+	{
+		m_chunk_worker_running = true;
+		m_chunk_worker = std::thread(&Map::chunk_worker, this);
+	}
+	lock.unlock();
+	m_chunk_condition.notify_one();
+}
+
+/*
+* Sets the shader programs every map renders with
+* MAP_RENDER_MESH draws the chunk meshes, MAP_RENDER_TILE_TEXTURE draws one
+* quad that looks tiles up from the tile index texture
+*
+* @param tile_array_program, SHADERPROGRAM loaded with the tile array shaders
+* @param tilemap_program, SHADERPROGRAM loaded with the tilemap shaders
+*/
+void Map::set_programs(ShaderProgram* tile_array_program, ShaderProgram* tilemap_program)
+{
+	s_tile_array_program = tile_array_program;
+	s_tilemap_program = tilemap_program;
+}
+
+/*
+* Renders with whichever map renderer is selected
+* Always with the programs from set_programs() rather than the scene's,
+* since the map shaders need their own inputs
+*/
+void Map::render()
+{
+	RenderTimer timer(RENDER_MAP);
+	RenderBackend::get()->set_layer(RENDER_LAYER_MAP);
+
+	if (s_render_mode == MAP_RENDER_TILE_TEXTURE) render_tile_texture(s_tilemap_program);
+	else render_mesh(s_tile_array_program);
+}
+
+/*
+* Draws every loaded chunk mesh
+*
+* @param program, SHADERPROGRAM loaded with the tile array shaders
+*/
+void Map::render_mesh(ShaderProgram* program)
+{
+	program->set_uniform_float("time", s_animation_time);
+	program->set_uniform_float("layerCount", (float)(m_tile_count_x * m_tile_count_y));
+
+	RenderBackend* backend = RenderBackend::get();
+	backend->use_program(program->get_program_id());
+	backend->bind_texture(GL_TEXTURE_2D_ARRAY, m_array_texture_id, 0);
+
+	// only loaded chunks are drawn
+	std::lock_guard<std::mutex> lock(m_chunk_mutex);
+	for (MapChunk& chunk : m_chunks)
+	{
+		if (chunk.state != CHUNK_LOADED || chunk.vertices.empty()) continue;
+
+		// move the chunk's tile-space mesh into place and scale it up to the tile size
+		program->set_model_transform(Transform2D(
+			glm::vec2((m_tile_size * chunk.chunk_x * MAP_CHUNK_SIZE) - (m_tile_size / 2),
+				-(m_tile_size * chunk.chunk_y * MAP_CHUNK_SIZE) + (m_tile_size / 2)),
+			glm::vec2(m_tile_size)));
+
+		int quad_count = (int)chunk.vertices.size() / 4;
+
+		backend->set_attribute(program->get_position_attribute(), 2, GL_SHORT, false, sizeof(TileVertex), &chunk.vertices[0].x);
+		backend->set_attribute(program->get_layer_attribute(), 1, GL_SHORT, false, sizeof(TileVertex), &chunk.vertices[0].layer);
+		backend->set_attribute(program->get_animation_attribute(), 2, GL_UNSIGNED_BYTE, false, sizeof(TileVertex), &chunk.vertices[0].frame_count);
+		backend->draw_quads(quad_count);
+	}
+
+	backend->disable_attribute(program->get_position_attribute());
+	backend->disable_attribute(program->get_layer_attribute());
+	backend->disable_attribute(program->get_animation_attribute());
+}
+
+/*
+* Uploads the level data as a texture with one texel per tile
+* Tile ids go in the red/luminance channel, wrapped to the tile set (see get_tile_index_texel),
+* so tile sets of more than 255 tiles are not supported
+*/
+void Map::upload_tile_index_texture()
+{
+	std::vector<unsigned char> tile_indices(m_width * m_height);
+	std::vector<unsigned int> row(m_width);
+	for (int y = 0; y < m_height; y++)
+	{
+		read_row(y, 0, m_width, row.data());
+		for (int x = 0; x < m_width; x++) tile_indices[y * m_width + x] = get_tile_index_texel(row[x]);
+	}
+
+	glGenTextures(1, &m_tile_index_texture_id);
+	glBindTexture(GL_TEXTURE_2D, m_tile_index_texture_id);
+
+	// rows are one byte per tile, so they aren't 4 byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, m_width, m_height, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, tile_indices.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+/*
+* What the tile index texture holds for a tile -- only a byte, so ids past the
+* tile set are wrapped here instead of in the shader, like build_chunk wraps them
+* A tile that wraps onto layer 0 is stored as the tile set size, which the shader
+* wraps the rest of the way, since a texel of 0 is an empty tile
+*
+* @param tile, the tile's id
+*/
+unsigned char Map::get_tile_index_texel(unsigned int tile) const
+{
+	if (tile == 0) return 0;
+
+	unsigned int layer_count = m_tile_count_x * m_tile_count_y;
+	return (unsigned char)((tile - 1) % layer_count + 1);
+}
+
+/*
+* Uploads the tile animations as a texture with one texel per tile set tile
+* The frame count goes in luminance and the frame rate in alpha
+*/
+void Map::upload_tile_animation_texture()
+{
+	std::vector<GLubyte> texels(m_tile_animations.size() * 2);
+	for (size_t i = 0; i < m_tile_animations.size(); i++)
+	{
+		texels[i * 2] = m_tile_animations[i].frame_count;
+		texels[i * 2 + 1] = m_tile_animations[i].frame_rate;
+	}
+
+	if (m_tile_animation_texture_id == 0) glGenTextures(1, &m_tile_animation_texture_id);
+	glBindTexture(GL_TEXTURE_2D, m_tile_animation_texture_id);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA, (GLsizei)m_tile_animations.size(), 1, 0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, texels.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+/*
+* Draws the whole map as one quad -- the fragment shader finds the tile
+* under each pixel in the tile index texture and samples the tile set
+* Cost doesn't depend on how many tiles the map has
+*
+* @param program, SHADERPROGRAM loaded with the tilemap shaders
+*/
+void Map::render_tile_texture(ShaderProgram* program)
+{
+	if (m_tile_index_texture_id == 0) upload_tile_index_texture();
+	if (m_tile_animation_texture_id == 0) upload_tile_animation_texture();
+
+	// the quad is in tile space, like a chunk mesh covering the whole map
+	program->set_model_transform(Transform2D(glm::vec2(-(m_tile_size / 2), (m_tile_size / 2)), glm::vec2(m_tile_size)));
+
+	program->set_uniform_int("diffuse", 0);
+	program->set_uniform_int("tileIndices", 1);
+	program->set_uniform_vec2("mapSize", (float)m_width, (float)m_height);
+	program->set_uniform_vec2("tileCount", (float)m_tile_count_x, (float)m_tile_count_y);
+	program->set_uniform_int("tileAnimations", 2);
+	program->set_uniform_float("time", s_animation_time);
+
+	float width = (float)m_width;
+	float height = (float)m_height;
+	float vertices[] = { 0.0f, 0.0f, 0.0f, -height, width, -height, width, 0.0f };
+
+	RenderBackend* backend = RenderBackend::get();
+	backend->bind_texture(GL_TEXTURE_2D, m_tile_index_texture_id, 1);
+	backend->bind_texture(GL_TEXTURE_2D, m_tile_animation_texture_id, 2);
+	backend->bind_texture(GL_TEXTURE_2D, m_texture_id, 0);
+
+	backend->set_attribute(program->get_position_attribute(), 2, GL_FLOAT, false, 0, vertices);
+	backend->draw_quads(1);
+	backend->disable_attribute(program->get_position_attribute());
+}
+
+/*
+* Changes one tile of the map
+* The chunk holding the tile is rebuilt and the tile index texture,
+* if there is one, only has its single texel updated
+* Occluders are only rebuilt for the chunks the tile and its neighbours are in
+*
+* @param x, y, tile position in the level array
+* @param tile, the new tile id
+*/
+void Map::set_tile(int x, int y, unsigned int tile)
 {
-	glm::mat4 model_matrix = glm::mat4(1.0f);
-	program->set_model_matrix(model_matrix);
+	if (x < 0 || x >= m_width)  return;
+	if (y < 0 || y >= m_height) return;
 
-	glUseProgram(program->get_program_id());
+	{
+		std::lock_guard<std::mutex> lock(m_chunk_mutex);
 
-	glVertexAttribPointer(program->get_position_attribute(), 2, GL_FLOAT, false, 0, m_vertices.data());
-	glEnableVertexAttribArray(program->get_position_attribute());
-	glVertexAttribPointer(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 0, m_texture_coordinates.data());
-	glEnableVertexAttribArray(program->get_tex_coordinate_attribute());
+		// level files are mapped read-only, so the first edit of a baked level takes a copy
+		// and a tile id too big for the copy's ids makes a wider one
+		int index_size = SparseTileLayer::get_index_size(tile);
+		if (m_sparse_tiles == NULL || index_size > m_sparse_tiles->get_index_size())
+		{
+			build_sparse_tiles(std::max(index_size, get_tile_index_size()));
+		}
+		{
+			std::lock_guard<std::mutex> tile_lock(m_tile_mutex);
+			m_sparse_tiles->set_tile(x, y, tile);
+		}
+		m_is_edited = true;
 
-	glBindTexture(GL_TEXTURE_2D, m_texture_id);
+		MapChunk& chunk = m_chunks[(y / MAP_CHUNK_SIZE) * m_chunk_count_x + (x / MAP_CHUNK_SIZE)];
+		chunk.revision++;
+		m_revision++;
+		if (chunk.state == CHUNK_LOADED)
+		{
+			chunk.vertices.clear();
+			build_chunk(chunk.chunk_x, chunk.chunk_y, is_baked(), chunk.vertices);
+		}
+	}
 
-	glDrawArrays(GL_TRIANGLES, 0, (int)m_vertices.size() / 2);
-	glDisableVertexAttribArray(program->get_position_attribute());
-	glDisableVertexAttribArray(program->get_tex_coordinate_attribute());
+	// the tile's own edges and its neighbours' -- which can be in the next chunk over -- are worked out again when next asked for
+	for (int chunk_y = std::max(y - 1, 0) / MAP_CHUNK_SIZE; chunk_y <= std::min(y + 1, m_height - 1) / MAP_CHUNK_SIZE; chunk_y++)
+	{
+		for (int chunk_x = std::max(x - 1, 0) / MAP_CHUNK_SIZE; chunk_x <= std::min(x + 1, m_width - 1) / MAP_CHUNK_SIZE; chunk_x++)
+		{
+			m_chunks[chunk_y * m_chunk_count_x + chunk_x].has_occluders = false;
+		}
+	}
+
+	if (m_tile_index_texture_id != 0)
+	{
+		unsigned char tile_index = get_tile_index_texel(tile);
+		glBindTexture(GL_TEXTURE_2D, m_tile_index_texture_id);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, 1, 1, GL_LUMINANCE, GL_UNSIGNED_BYTE, &tile_index);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
 }
 
-bool Map::is_solid(glm::vec3 position, float* penetration_x, float* penetration_y)
+/*
+* is_solid() for any tile size -- finds the tile with a divide, floor and ceil
+*
+* @param position, world position to test
+* @param penetration_x, penetration_y, how far into the tile the position is, 0 if it isn't in a solid tile
+*/
+bool Map::is_solid_general(glm::vec3 position, float* penetration_x, float* penetration_y)
 {
 	*penetration_x = 0;
 	*penetration_y = 0;
@@ -105,8 +812,7 @@ bool Map::is_solid(glm::vec3 position, float* penetration_x, float* penetration_
 	if (tile_x < 0 || tile_x >= m_width)  return false;
 	if (tile_y < 0 || tile_y >= m_height) return false;
 
-	int tile = m_level_data[tile_y * m_width + tile_x];
-	if (tile == 0) return false;
+	if (!is_solid_tile(tile_x, tile_y)) return false;
 
 	float tile_center_x = (tile_x * m_tile_size);
 	float tile_center_y = -(tile_y * m_tile_size);
@@ -115,4 +821,119 @@ bool Map::is_solid(glm::vec3 position, float* penetration_x, float* penetration_
 	*penetration_y = (m_tile_size / 2) - fabs(position.y - tile_center_y);
 
 	return true;
+}
+
+/*
+* is_solid() for a tile size of 2^TILE_SIZE_LOG2 world units, known at compile time
+* The position goes to MAP_FIXED_POINT_BITS fixed point, rounded down, and a
+* shift then gives the tile. Out of bounds tiles are clamped to a tile that is
+* safe to read and masked out afterwards, so finding the tile never branches
+* Positions past 32768 world units are clamped to it before converting, so
+* the map has to fit inside that
+* Measured slower than is_solid_general() (see --bench-collision), so the
+* game doesn't use it
+*
+* @param position, world position to test
+* @param penetration_x, penetration_y, how far into the tile the position is, 0 if it isn't in a solid tile
+*/
+template <int TILE_SIZE_LOG2>
+bool Map::is_solid_fixed(glm::vec3 position, float* penetration_x, float* penetration_y)
+{
+	const float tile_size = TILE_SIZE_LOG2 >= 0 ? (float)(1 << TILE_SIZE_LOG2) : 1.0f / (1 << -TILE_SIZE_LOG2);
+	const int shift = MAP_FIXED_POINT_BITS + TILE_SIZE_LOG2;
+
+	// tiles are centred on multiples of the tile size, and our array counts up as Y goes down
+	// converting truncates towards 0, so negative positions take one off
+	// clamped to the floats just inside int32_t, since converting anything past them is undefined
+	float scaled_x = glm::clamp((position.x + tile_size / 2) * (1 << MAP_FIXED_POINT_BITS), -MAP_FIXED_POINT_LIMIT, MAP_FIXED_POINT_LIMIT);
+	float scaled_y = glm::clamp((tile_size / 2 - position.y) * (1 << MAP_FIXED_POINT_BITS), -MAP_FIXED_POINT_LIMIT, MAP_FIXED_POINT_LIMIT);
+	int32_t fixed_x = (int32_t)scaled_x;
+	int32_t fixed_y = (int32_t)scaled_y;
+	fixed_x -= scaled_x < (float)fixed_x;
+	fixed_y -= scaled_y < (float)fixed_y;
+
+	int tile_x = fixed_x >> shift;
+	int tile_y = fixed_y >> shift;
+
+	// one unsigned compare per axis catches both sides
+	bool is_inside = ((unsigned int)tile_x < (unsigned int)m_width) & ((unsigned int)tile_y < (unsigned int)m_height);
+	int clamped_x = std::min(std::max(tile_x, 0), m_width - 1);
+	int clamped_y = std::min(std::max(tile_y, 0), m_height - 1);
+	bool is_solid = is_inside & is_solid_tile(clamped_x, clamped_y);
+
+	float tile_center_x = tile_x * tile_size;
+	float tile_center_y = -(tile_y * tile_size);
+
+	float mask = (float)is_solid;
+	*penetration_x = mask * ((tile_size / 2) - fabs(position.x - tile_center_x));
+	*penetration_y = mask * ((tile_size / 2) - fabs(position.y - tile_center_y));
+
+	return is_solid;
+}
+
+template bool Map::is_solid_fixed<-2>(glm::vec3, float*, float*);
+template bool Map::is_solid_fixed<-1>(glm::vec3, float*, float*);
+template bool Map::is_solid_fixed<0>(glm::vec3, float*, float*);
+template bool Map::is_solid_fixed<1>(glm::vec3, float*, float*);
+template bool Map::is_solid_fixed<2>(glm::vec3, float*, float*);
+template bool Map::is_solid_fixed<3>(glm::vec3, float*, float*);
+
+/*
+* Makes a tile animate -- it cycles through itself and the tiles after it in the tile set,
+* wrapping around to the start of the tile set
+* Meant for level setup, since chunks that are already loaded get rebuilt
+*
+* @param tile, tile id of the first frame
+* @param frame_count, number of frames, 1 to stop animating
+* @param frame_rate, frames per second, kept to the nearest 1 / TILE_FRAME_RATE_STEPS
+*/
+void Map::set_tile_animation(unsigned int tile, int frame_count, float frame_rate)
+{
+	int layer_count = m_tile_count_x * m_tile_count_y;
+	TileAnimation& animation = m_tile_animations[tile % layer_count];
+
+	{
+		std::lock_guard<std::mutex> lock(m_chunk_mutex);
+		{
+			// the chunk worker reads animations under m_tile_mutex
+			std::lock_guard<std::mutex> tile_lock(m_tile_mutex);
+			bool was_animated = animation.frame_count > 1;
+			animation.frame_count = (GLubyte)std::min(std::max(frame_count, 0), 255);
+			animation.frame_rate = (GLubyte)std::min(std::max((int)(frame_rate * TILE_FRAME_RATE_STEPS + 0.5f), 0), 255);
+			m_animated_tile_count += (animation.frame_count > 1) - was_animated;
+		}
+
+		for (MapChunk& chunk : m_chunks)
+		{
+			chunk.revision++;
+			if (chunk.state != CHUNK_LOADED) continue;
+
+			chunk.vertices.clear();
+			build_chunk(chunk.chunk_x, chunk.chunk_y, is_baked(), chunk.vertices);
+		}
+		m_revision++;
+	}
+
+	if (m_tile_animation_texture_id != 0) upload_tile_animation_texture();
+}
+
+/*
+* Moves every map's tile animations forward
+*
+* @param delta_time, seconds since the last call
+*/
+void Map::advance_animation(float delta_time)
+{
+	s_animation_time += delta_time;
+	s_animation_step++;
+}
+
+/*
+* Changes whenever what render() would draw changes
+* With animated tiles that is every animation step
+*/
+unsigned int const Map::get_revision() const
+{
+	if (m_animated_tile_count > 0) return m_revision + s_animation_step;
+	return m_revision;
 }
\ No newline at end of file
@@ -5,6 +5,11 @@
 #endif
 #define GL_GLEXT_PROTOTYPES 1
 #include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 #include <math.h>
 #include <SDL.h>
 #include <SDL_opengl.h>
@@ -12,6 +17,57 @@
 #include "glm/mat4x4.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "ShaderProgram.h"
+#include "LevelFile.h"
+#include "SparseTileLayer.h"
+
+#define MAP_CHUNK_SIZE        32 // chunks are MAP_CHUNK_SIZE x MAP_CHUNK_SIZE tiles
+#define MAP_CHUNK_LOAD_RADIUS 1  // chunks kept loaded around the camera's chunk
+#define MAP_FIXED_POINT_BITS  16 // fraction bits of the positions is_solid_fixed() works in
+#define MAP_FIXED_POINT_LIMIT 2147483520.0f // the biggest float below 2^31
+#define TILE_FRAME_RATE_STEPS 4  // tile animation rates are kept in quarter frames per second
+
+enum ChunkState { CHUNK_UNLOADED, CHUNK_QUEUED, CHUNK_LOADED };
+enum MapRenderMode { MAP_RENDER_MESH, MAP_RENDER_TILE_TEXTURE };
+
+// a tile that cycles through itself and the next frame_count - 1 tiles of the tile set
+// the shaders pick the frame from a time uniform, so meshes never change while animating
+struct TileAnimation
+{
+	GLubyte frame_count = 0;
+	GLubyte frame_rate = 0; // in 1 / TILE_FRAME_RATE_STEPS frames per second, so up to 63.75
+};
+
+// interleaved tile vertex -- position in tiles from the chunk origin, the tile set layer and its animation
+// uvs come from the position in the shader, so a quad spanning several tiles repeats its texture
+struct TileVertex
+{
+	GLshort x, y;
+	GLshort layer;
+	GLubyte frame_count, frame_rate;
+};
+
+// a side of a run of solid tiles that faces an empty tile, in world units -- lights stop here (see Lighting)
+struct OccluderEdge
+{
+	glm::vec2 start;
+	glm::vec2 end;
+};
+
+// one square piece of the map with its own mesh
+// runs of the same tile are merged into one quad, drawn with the shared quad index buffer
+struct MapChunk
+{
+	int chunk_x;
+	int chunk_y;
+	ChunkState state = CHUNK_UNLOADED;
+	unsigned int revision = 0; // bumped on every tile edit so stale builds are thrown out
+
+	std::vector<TileVertex> vertices;
+
+	// kept for every chunk, loaded or not, from the first time lights look at it -- only touched on the main thread
+	std::vector<OccluderEdge> occluders;
+	bool has_occluders = false;
+};
 
 class Map
 {
@@ -19,41 +75,139 @@ private:
 	int m_width;
 	int m_height;
 
-	// array that holds tile set positions
-	unsigned int* m_level_data;
-	GLuint m_texture_id; // tile set texture
+	// array that holds tile set positions -- usually read straight out of a mapped level file
+	// NULL while the tiles are run-length encoded in m_rle_tiles instead
+	const void* m_level_data;
+	int         m_tile_index_size; // bytes per id in m_level_data, and the least the map's own copy uses
+	void (*m_read_level_row)(const void* level_data, size_t first, int count, unsigned int* tiles); // picked by the size
+	RleTileLayer                m_rle_tiles;
+	std::shared_ptr<MappedFile> m_level_file; // keeps the mapping alive, NULL for a level in memory
+
+	// the map's own copy of its non-empty chunks, used instead of the level whenever there is one
+	// made by build() unless the level was baked, or by the first set_tile()
+	std::unique_ptr<SparseTileLayer> m_sparse_tiles;
+	std::mutex m_tile_mutex; // held by the chunk worker while it reads tiles, and to change m_sparse_tiles
+	bool       m_is_edited = false;
+
+	// one bit per tile, set for solid tiles -- baked levels only, until they are edited
+	// otherwise collisions and occluders look at m_sparse_tiles
+	const uint32_t* m_solid_mask = NULL;
+	int             m_solid_mask_stride; // uint32_ts per row
+
+	// chunk meshes and occluders from a compiled or built-in level, NULL if it wasn't baked
+	// the chunks' offsets count from the start of the level file, or a built-in level's own arrays
+	const unsigned char* m_baked_vertex_data = NULL;
+	const unsigned char* m_baked_occluder_data = NULL;
+	const LevelChunk*    m_baked_chunks = NULL;
+
+	GLuint m_texture_id;       // tile set texture
+	GLuint m_array_texture_id; // tile set split into one GL_TEXTURE_2D_ARRAY layer per tile
 
 	float m_tile_size;
 	int   m_tile_count_x;
 	int   m_tile_count_y;
 
-	std::vector<float> m_vertices;
-	std::vector<float> m_texture_coordinates;
+	// one texel per tile holding its id -- only created for MAP_RENDER_TILE_TEXTURE
+	GLuint m_tile_index_texture_id = 0;
+
+	// animation of each tile set tile, and the same as a texture for MAP_RENDER_TILE_TEXTURE
+	std::vector<TileAnimation> m_tile_animations;
+	int    m_animated_tile_count = 0;
+	GLuint m_tile_animation_texture_id = 0;
+
+	// chunk grid -- meshes are built, loaded and evicted per chunk
+	int m_chunk_count_x;
+	int m_chunk_count_y;
+	std::vector<MapChunk> m_chunks;
+
+	// background chunk builder
+	std::thread             m_chunk_worker;
+	std::mutex              m_chunk_mutex;
+	std::condition_variable m_chunk_condition;
+	std::deque<int>         m_chunk_queue;
+	bool                    m_chunk_worker_running = false;
+
+	// bumped whenever a chunk is loaded, evicted or edited, so cached frames know they're stale
+	std::atomic<unsigned int> m_revision{ 0 };
 
 	// map boundaries
 	float m_left_bound, m_right_bound, m_top_bound, m_bottom_bound;
+
+	// render mode shared by every map, picked at runtime
+	static MapRenderMode s_render_mode;
+	static ShaderProgram* s_tile_array_program;
+	static ShaderProgram* s_tilemap_program;
+
+	// seconds of animation shared by every map, and how many times it has been advanced
+	static float        s_animation_time;
+	static unsigned int s_animation_step;
+
+	// bakes levels out of the same chunk builders the game uses
+	friend class LevelCompiler;
+
+	void initialise(int width, int height, const void* level_data, int tile_index_size, GLuint texture_id, GLuint array_texture_id,
+		float tile_size, int tile_count_x, int tile_count_y);
+	void compute_bounds();
+	void build_chunk(int chunk_x, int chunk_y, bool is_baked, std::vector<TileVertex>& vertices);
+	void build_occluders(MapChunk& chunk);
+	const std::vector<OccluderEdge>& get_chunk_occluders(MapChunk& chunk);
+	void build_sparse_tiles(int index_size);
+	void read_row(int y, int first_x, int count, unsigned int* tiles) const;
+	bool is_baked() const;
+	bool has_tile(int x, int y) const;
+	bool const is_solid_tile(int x, int y) const
+	{
+		if (m_solid_mask == NULL) return m_sparse_tiles->is_solid(x, y);
+		return (m_solid_mask[y * m_solid_mask_stride + (x >> 5)] >> (x & 31)) & 1;
+	}
+	void chunk_worker();
+
+	void render_mesh(ShaderProgram* program);
+	void render_tile_texture(ShaderProgram* program);
+	void upload_tile_index_texture();
+	unsigned char get_tile_index_texel(unsigned int tile) const;
+	void upload_tile_animation_texture();
 public:
 	// default constructor override
-	Map(int width, int height, unsigned int* level_data, GLuint texture_id, float tile_size, int
-		tile_count_x, int tile_count_y);
+	Map(int width, int height, const unsigned int* level_data, GLuint texture_id, GLuint array_texture_id,
+		float tile_size, int tile_count_x, int tile_count_y);
+	Map(const LevelFile& level, GLuint texture_id, GLuint array_texture_id);
+	~Map();
 
 	void build();
-	void render(ShaderProgram* program);
-	bool is_solid(glm::vec3 position, float* penetration_x, float* penetration_y);
+	void stream_chunks(glm::vec3 camera_position);
+	void render();
+	bool is_solid(glm::vec3 position, float* penetration_x, float* penetration_y) { return is_solid_general(position, penetration_x, penetration_y); }
+	bool is_solid_general(glm::vec3 position, float* penetration_x, float* penetration_y);
+	template <int TILE_SIZE_LOG2>
+	bool is_solid_fixed(glm::vec3 position, float* penetration_x, float* penetration_y);
+	void get_occluders(glm::vec2 min, glm::vec2 max, std::vector<OccluderEdge>& edges);
+	void set_tile(int x, int y, unsigned int tile);
+	unsigned int get_tile(int x, int y) const;
+	void set_tile_animation(unsigned int tile, int frame_count, float frame_rate);
+
+	static void advance_animation(float delta_time);
+
+	static void set_programs(ShaderProgram* tile_array_program, ShaderProgram* tilemap_program);
+	static void set_render_mode(MapRenderMode mode) { s_render_mode = mode; }
+	static MapRenderMode const get_render_mode() { return s_render_mode; }
 
 	// GETTERS
 	int const get_width()  const { return m_width; }
 	int const get_height() const { return m_height; }
 
-	unsigned int* const get_level_data() const { return m_level_data; }
+	size_t const get_tile_byte_count() const;
+	int    const get_tile_index_size() const { return m_sparse_tiles != NULL ? m_sparse_tiles->get_index_size() : m_tile_index_size; }
 	GLuint        const get_texture_id() const { return m_texture_id; }
+	GLuint        const get_array_texture_id() const { return m_array_texture_id; }
 
 	float const get_tile_size()    const { return m_tile_size; }
 	int   const get_tile_count_x() const { return m_tile_count_x; }
 	int   const get_tile_count_y() const { return m_tile_count_y; }
 
-	std::vector<float> const get_vertices()            const { return m_vertices; }
-	std::vector<float> const get_texture_coordinates() const { return m_texture_coordinates; }
+	int const get_chunk_count_x() const { return m_chunk_count_x; }
+	int const get_chunk_count_y() const { return m_chunk_count_y; }
+	unsigned int const get_revision() const;
 
 	float const get_left_bound()   const { return m_left_bound; }
 	float const get_right_bound()  const { return m_right_bound; }
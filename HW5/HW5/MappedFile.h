@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+/*
+* A whole file mapped read-only into memory -- the OS pages it in as it is read,
+* so nothing is copied into a buffer of our own
+* Memory mapping is per platform: Win32 file mappings, mmap everywhere else
+*/
+class MappedFile
+{
+private:
+    const unsigned char* m_data = NULL;
+    size_t m_size = 0;
+
+#ifdef _WIN32
+    void* m_file = NULL;    // HANDLE
+    void* m_mapping = NULL; // HANDLE
+#endif
+
+public:
+    MappedFile() {}
+    ~MappedFile();
+
+    // owns the mapping, so it can't be copied
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& filepath);
+    void close();
+
+    bool                 const is_open()  const { return m_data != NULL; }
+    const unsigned char* const get_data() const { return m_data; }
+    size_t               const get_size() const { return m_size; }
+};
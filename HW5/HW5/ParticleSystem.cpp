@@ -0,0 +1,232 @@
+#include "ParticleSystem.h"
+#include "Benchmark.h"
+#include "RenderBackend.h"
+#include "Transform2D.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PARTICLE_USE_SSE
+#include <emmintrin.h>
+#endif
+
+ParticleSystem* ParticleSystem::s_effects = NULL;
+
+/*
+* @param capacity, most particles alive at once -- emitting past it drops particles
+* @param particle_size, width of a new particle in world units, it shrinks to 0 over its life
+* @param gravity, vertical acceleration
+*/
+ParticleSystem::ParticleSystem(int capacity, float particle_size, float gravity)
+{
+    m_capacity = capacity;
+    m_particle_size = particle_size;
+    m_gravity = gravity;
+
+    m_position_x.resize(capacity);
+    m_position_y.resize(capacity);
+    m_velocity_x.resize(capacity);
+    m_velocity_y.resize(capacity);
+    m_age.resize(capacity);
+    m_lifetime.resize(capacity);
+}
+
+// xorshift -- cheap, and the same burst every run
+float ParticleSystem::random_float()
+{
+    m_random_state ^= m_random_state << 13;
+    m_random_state ^= m_random_state >> 17;
+    m_random_state ^= m_random_state << 5;
+    return (m_random_state >> 8) * (1.0f / 16777216.0f);
+}
+
+/*
+* Spawns particles flying out of a point in random directions
+*
+* @param position, where they start
+* @param count, how many
+* @param speed, fastest starting speed -- each particle gets between half and all of it
+* @param lifetime, longest life in seconds -- again between half and all of it
+*/
+void ParticleSystem::emit(glm::vec3 position, int count, float speed, float lifetime)
+{
+    count = std::min(count, m_capacity - m_count);
+
+    for (int i = m_count; i < m_count + count; i++)
+    {
+        float angle = random_float() * 6.2831853f;
+        float particle_speed = speed * (0.5f + 0.5f * random_float());
+
+        m_position_x[i] = position.x;
+        m_position_y[i] = position.y;
+        m_velocity_x[i] = cosf(angle) * particle_speed;
+        m_velocity_y[i] = sinf(angle) * particle_speed;
+        m_age[i] = 0.0f;
+        m_lifetime[i] = lifetime * (0.5f + 0.5f * random_float());
+    }
+
+    m_count += count;
+}
+
+/*
+* Emits into the game's effects, if there are any
+*/
+void ParticleSystem::burst(glm::vec3 position, int count, float speed, float lifetime)
+{
+    if (s_effects != NULL) s_effects->emit(position, count, speed, lifetime);
+}
+
+/*
+* Moves every particle forward and removes the ones that have run out of life
+* Same integration as Entity::update -- velocity first, then position
+*
+* @param delta_time, seconds to advance
+*/
+void ParticleSystem::update(float delta_time)
+{
+    float* position_x = m_position_x.data();
+    float* position_y = m_position_y.data();
+    float* velocity_x = m_velocity_x.data();
+    float* velocity_y = m_velocity_y.data();
+    float* age = m_age.data();
+
+    int i = 0;
+
+#ifdef PARTICLE_USE_SSE
+    __m128 step = _mm_set1_ps(delta_time);
+    __m128 gravity_step = _mm_set1_ps(m_gravity * delta_time);
+
+    for (; i + 4 <= m_count; i += 4)
+    {
+        __m128 new_velocity_y = _mm_add_ps(_mm_loadu_ps(velocity_y + i), gravity_step);
+        _mm_storeu_ps(velocity_y + i, new_velocity_y);
+
+        _mm_storeu_ps(position_x + i, _mm_add_ps(_mm_loadu_ps(position_x + i), _mm_mul_ps(_mm_loadu_ps(velocity_x + i), step)));
+        _mm_storeu_ps(position_y + i, _mm_add_ps(_mm_loadu_ps(position_y + i), _mm_mul_ps(new_velocity_y, step)));
+        _mm_storeu_ps(age + i, _mm_add_ps(_mm_loadu_ps(age + i), step));
+    }
+#endif
+
+    // the last few, or all of them without SSE
+    for (; i < m_count; i++)
+    {
+        velocity_y[i] += m_gravity * delta_time;
+        position_x[i] += velocity_x[i] * delta_time;
+        position_y[i] += velocity_y[i] * delta_time;
+        age[i] += delta_time;
+    }
+
+    // order doesn't matter, so the last live particle fills each hole
+    for (int j = 0; j < m_count; )
+    {
+        if (m_age[j] < m_lifetime[j])
+        {
+            j++;
+            continue;
+        }
+
+        m_count--;
+        m_position_x[j] = m_position_x[m_count];
+        m_position_y[j] = m_position_y[m_count];
+        m_velocity_x[j] = m_velocity_x[m_count];
+        m_velocity_y[j] = m_velocity_y[m_count];
+        m_age[j] = m_age[m_count];
+        m_lifetime[j] = m_lifetime[m_count];
+    }
+}
+
+/*
+* Fills the vertex array with one quad per live particle, shrinking with age
+*/
+void ParticleSystem::build_vertices()
+{
+    m_vertices.resize(m_count * 16);
+    float* vertex = m_vertices.data();
+
+    for (int i = 0; i < m_count; i++)
+    {
+        float half_size = 0.5f * m_particle_size * (1.0f - m_age[i] / m_lifetime[i]);
+        float left = m_position_x[i] - half_size;
+        float right = m_position_x[i] + half_size;
+        float top = m_position_y[i] + half_size;
+        float bottom = m_position_y[i] - half_size;
+
+        // top left, bottom left, bottom right, top right
+        vertex[0] = left;   vertex[1] = top;     vertex[2] = 0.0f;  vertex[3] = 0.0f;
+        vertex[4] = left;   vertex[5] = bottom;  vertex[6] = 0.0f;  vertex[7] = 1.0f;
+        vertex[8] = right;  vertex[9] = bottom;  vertex[10] = 1.0f; vertex[11] = 1.0f;
+        vertex[12] = right; vertex[13] = top;    vertex[14] = 1.0f; vertex[15] = 0.0f;
+        vertex += 16;
+    }
+}
+
+/*
+* Draws every live particle -- one draw, unless there are more than the
+* quad indices can reach
+*
+* @param program, the textured SHADERPROGRAM
+*/
+void ParticleSystem::render(ShaderProgram* program)
+{
+    RenderTimer timer(RENDER_PARTICLES);
+
+    if (m_count == 0) return;
+
+    build_vertices();
+
+    // particle positions are already in world space
+    program->set_model_transform(Transform2D());
+
+    RenderBackend* backend = RenderBackend::get();
+    backend->set_layer(RENDER_LAYER_PARTICLES);
+    backend->bind_texture(GL_TEXTURE_2D, m_texture_id, 0);
+
+    for (int first = 0; first < m_count; first += PARTICLE_QUADS_PER_DRAW)
+    {
+        const float* vertices = m_vertices.data() + first * 16;
+        backend->set_attribute(program->get_position_attribute(), 2, GL_FLOAT, false, 4 * sizeof(float), vertices);
+        backend->set_attribute(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 4 * sizeof(float), vertices + 2);
+        backend->draw_quads(std::min(m_count - first, PARTICLE_QUADS_PER_DRAW));
+    }
+
+    backend->disable_attribute(program->get_position_attribute());
+    backend->disable_attribute(program->get_tex_coordinate_attribute());
+}
+
+/*
+* Makes a round white dot that fades out towards its edge, for particles
+* that have no art of their own
+*
+* @param size, width and height in pixels
+*/
+GLuint ParticleSystem::create_dot_texture(int size)
+{
+    std::vector<unsigned char> pixels(size * size * 4);
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            float dx = (x + 0.5f) / size * 2.0f - 1.0f;
+            float dy = (y + 0.5f) / size * 2.0f - 1.0f;
+            float alpha = std::max(0.0f, 1.0f - sqrtf(dx * dx + dy * dy));
+
+            unsigned char* pixel = &pixels[(y * size + x) * 4];
+            pixel[0] = 255;
+            pixel[1] = 255;
+            pixel[2] = 255;
+            pixel[3] = (unsigned char)(alpha * 255.0f);
+        }
+    }
+
+    GLuint texture_id;
+    glGenTextures(1, &texture_id);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    return texture_id;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+
+#define GL_GLEXT_PROTOTYPES 1
+#include <vector>
+#include <SDL_opengl.h>
+#include "glm/mat4x4.hpp"
+#include "ShaderProgram.h"
+
+#define PARTICLE_EFFECT_CAPACITY 4096
+#define PARTICLE_QUADS_PER_DRAW  16384 // the shared quad indices are 16 bit, so 65536 vertices at most
+
+/*
+* A fixed size pool of particles sharing one texture, drawn with one batched draw
+* Particles are stored as a structure of arrays so the update loop streams through
+* each array and integrates four particles at a time with SSE
+* Dead particles are swapped with the last live one, so the live ones stay packed
+*/
+class ParticleSystem
+{
+private:
+    static ParticleSystem* s_effects;
+
+    int m_capacity;
+    int m_count = 0;
+
+    std::vector<float> m_position_x, m_position_y;
+    std::vector<float> m_velocity_x, m_velocity_y;
+    std::vector<float> m_age, m_lifetime;
+
+    GLuint m_texture_id = 0;
+    float  m_particle_size;
+    float  m_gravity;
+
+    unsigned int m_random_state = 0x9E3779B9;
+
+    // interleaved position and uv, 4 vertices per live particle
+    std::vector<float> m_vertices;
+
+    float random_float();
+
+public:
+    ParticleSystem(int capacity, float particle_size, float gravity);
+
+    void emit(glm::vec3 position, int count, float speed, float lifetime);
+    void update(float delta_time);
+    void build_vertices();
+    void render(ShaderProgram* program);
+    void clear() { m_count = 0; }
+
+    void set_texture_id(GLuint texture_id) { m_texture_id = texture_id; }
+
+    int const get_count()    const { return m_count; }
+    int const get_capacity() const { return m_capacity; }
+
+    static GLuint create_dot_texture(int size);
+
+    // the game's effects -- gameplay code emits into it without knowing the scene
+    static ParticleSystem* get() { return s_effects; }
+    static void set(ParticleSystem* effects) { s_effects = effects; }
+    static void burst(glm::vec3 position, int count, float speed, float lifetime);
+};
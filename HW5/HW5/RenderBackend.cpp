@@ -0,0 +1,247 @@
+#include "RenderBackend.h"
+#include "Utility.h"
+
+GLRenderBackend g_gl_render_backend;
+RenderBackend* RenderBackend::s_backend = &g_gl_render_backend;
+
+// ----- OPENGL ----- //
+
+void GLRenderBackend::use_program(GLuint program_id)
+{
+    glUseProgram(program_id);
+}
+
+GLint GLRenderBackend::get_uniform_location(GLuint program_id, const char* name)
+{
+    return glGetUniformLocation(program_id, name);
+}
+
+void GLRenderBackend::set_uniform_matrix(GLint location, const glm::mat4& matrix)
+{
+    glUniformMatrix4fv(location, 1, GL_FALSE, &matrix[0][0]);
+}
+
+void GLRenderBackend::set_uniform_vec4(GLint location, float x, float y, float z, float w)
+{
+    glUniform4f(location, x, y, z, w);
+}
+
+void GLRenderBackend::set_uniform_vec2(GLint location, float x, float y)
+{
+    glUniform2f(location, x, y);
+}
+
+void GLRenderBackend::set_uniform_int(GLint location, int value)
+{
+    glUniform1i(location, value);
+}
+
+void GLRenderBackend::set_uniform_float(GLint location, float value)
+{
+    glUniform1f(location, value);
+}
+
+void GLRenderBackend::bind_texture(GLenum target, GLuint texture_id, int unit)
+{
+    // unit 0 stays active everywhere else
+    if (unit != 0) glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(target, texture_id);
+    if (unit != 0) glActiveTexture(GL_TEXTURE0);
+}
+
+void GLRenderBackend::set_attribute(GLuint attribute, int size, GLenum type, bool normalised, int stride, const void* data)
+{
+    glVertexAttribPointer(attribute, size, type, normalised, stride, data);
+    glEnableVertexAttribArray(attribute);
+}
+
+void GLRenderBackend::disable_attribute(GLuint attribute)
+{
+    glDisableVertexAttribArray(attribute);
+}
+
+void GLRenderBackend::draw_quads(int quad_count)
+{
+    glDrawElements(GL_TRIANGLES, quad_count * 6, GL_UNSIGNED_SHORT, Utility::get_quad_indices(quad_count));
+}
+
+void GLRenderBackend::bind_framebuffer(GLuint framebuffer)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void GLRenderBackend::clear()
+{
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void GLRenderBackend::clear_to_colour(const glm::vec4& colour)
+{
+    GLfloat previous[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, previous);
+    glClearColor(colour.r, colour.g, colour.b, colour.a);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glClearColor(previous[0], previous[1], previous[2], previous[3]);
+}
+
+void GLRenderBackend::set_blend_mode(BlendMode mode)
+{
+    if (mode == BLEND_NONE)
+    {
+        glDisable(GL_BLEND);
+        return;
+    }
+
+    glEnable(GL_BLEND);
+    switch (mode)
+    {
+    case BLEND_ADDITIVE: glBlendFunc(GL_ONE, GL_ONE); break;
+    case BLEND_MULTIPLY: glBlendFunc(GL_DST_COLOR, GL_ZERO); break;
+    default:             glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); break;
+    }
+}
+
+// ----- RECORDING ----- //
+
+RecordingRenderBackend::RecordingRenderBackend(bool store_commands)
+{
+    m_store_commands = store_commands;
+}
+
+void RecordingRenderBackend::record(RenderCommandType type, GLuint id, int value, int bytes)
+{
+    if (m_store_commands) m_commands.push_back({ type, id, value, bytes });
+}
+
+void RecordingRenderBackend::use_program(GLuint program_id)
+{
+    if (program_id == m_program_id) return;
+
+    m_program_id = program_id;
+    m_stats.program_changes++;
+    record(COMMAND_USE_PROGRAM, program_id, 0, 0);
+}
+
+/*
+* There is no program to ask, so every name gets a made up location of its own
+* (the same in every program), starting at RENDER_RECORDED_UNIFORM_BASE so it
+* can't be mistaken for a location ShaderProgram got from GL when it loaded
+* A single -1 for every name would let the render queue mistake one uniform for another
+*/
+GLint RecordingRenderBackend::get_uniform_location(GLuint program_id, const char* name)
+{
+    std::map<std::string, GLint>::iterator found = m_uniform_locations.find(name);
+    if (found != m_uniform_locations.end()) return found->second;
+
+    GLint location = RENDER_RECORDED_UNIFORM_BASE + (GLint)m_uniform_locations.size();
+    m_uniform_locations[name] = location;
+    return location;
+}
+
+void RecordingRenderBackend::set_uniform_matrix(GLint location, const glm::mat4& matrix)
+{
+    m_stats.uniform_updates++;
+    record(COMMAND_SET_UNIFORM, (GLuint)location, 16, 0);
+}
+
+void RecordingRenderBackend::set_uniform_vec4(GLint location, float x, float y, float z, float w)
+{
+    m_stats.uniform_updates++;
+    record(COMMAND_SET_UNIFORM, (GLuint)location, 4, 0);
+}
+
+void RecordingRenderBackend::set_uniform_vec2(GLint location, float x, float y)
+{
+    m_stats.uniform_updates++;
+    record(COMMAND_SET_UNIFORM, (GLuint)location, 2, 0);
+}
+
+void RecordingRenderBackend::set_uniform_int(GLint location, int value)
+{
+    m_stats.uniform_updates++;
+    record(COMMAND_SET_UNIFORM, (GLuint)location, 1, 0);
+}
+
+void RecordingRenderBackend::set_uniform_float(GLint location, float value)
+{
+    m_stats.uniform_updates++;
+    record(COMMAND_SET_UNIFORM, (GLuint)location, 1, 0);
+}
+
+void RecordingRenderBackend::bind_texture(GLenum target, GLuint texture_id, int unit)
+{
+    if (unit < 0 || unit >= RENDER_MAX_TEXTURE_UNITS || m_textures[unit] == texture_id) return;
+
+    m_textures[unit] = texture_id;
+    m_stats.texture_changes++;
+    record(COMMAND_BIND_TEXTURE, texture_id, unit, 0);
+}
+
+void RecordingRenderBackend::set_attribute(GLuint attribute, int size, GLenum type, bool normalised, int stride, const void* data)
+{
+    if (attribute >= RENDER_MAX_ATTRIBUTES) return;
+
+    int component_bytes = 4;
+    if (type == GL_SHORT || type == GL_UNSIGNED_SHORT) component_bytes = 2;
+    else if (type == GL_BYTE || type == GL_UNSIGNED_BYTE) component_bytes = 1;
+
+    m_attribute_bytes[attribute] = size * component_bytes;
+    record(COMMAND_SET_ATTRIBUTE, attribute, size, size * component_bytes);
+}
+
+void RecordingRenderBackend::disable_attribute(GLuint attribute)
+{
+    if (attribute >= RENDER_MAX_ATTRIBUTES) return;
+
+    m_attribute_bytes[attribute] = 0;
+    record(COMMAND_DISABLE_ATTRIBUTE, attribute, 0, 0);
+}
+
+void RecordingRenderBackend::draw_quads(int quad_count)
+{
+    int bytes_per_vertex = 0;
+    for (int i = 0; i < RENDER_MAX_ATTRIBUTES; i++) bytes_per_vertex += m_attribute_bytes[i];
+
+    int vertex_bytes = quad_count * 4 * bytes_per_vertex;
+
+    m_stats.draw_calls++;
+    m_stats.quads += quad_count;
+    m_stats.vertex_bytes += vertex_bytes;
+    m_stats.index_bytes += quad_count * 6 * (int)sizeof(GLushort);
+    record(COMMAND_DRAW, 0, quad_count, vertex_bytes);
+}
+
+void RecordingRenderBackend::bind_framebuffer(GLuint framebuffer)
+{
+    m_stats.framebuffer_changes++;
+    record(COMMAND_BIND_FRAMEBUFFER, framebuffer, 0, 0);
+}
+
+void RecordingRenderBackend::clear()
+{
+    record(COMMAND_CLEAR, 0, 0, 0);
+}
+
+void RecordingRenderBackend::clear_to_colour(const glm::vec4& colour)
+{
+    record(COMMAND_CLEAR, 0, 0, 0);
+}
+
+void RecordingRenderBackend::set_blend_mode(BlendMode mode)
+{
+    record(COMMAND_SET_BLEND_MODE, 0, (int)mode, 0);
+}
+
+/*
+* Clears the recorded commands and totals, and forgets the bound state
+* so the next frame counts its changes from scratch
+*/
+void RecordingRenderBackend::reset()
+{
+    m_program_id = 0;
+    for (int i = 0; i < RENDER_MAX_TEXTURE_UNITS; i++) m_textures[i] = 0;
+    for (int i = 0; i < RENDER_MAX_ATTRIBUTES; i++) m_attribute_bytes[i] = 0;
+
+    m_commands.clear();
+    m_stats = RenderStats();
+}
@@ -0,0 +1,166 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+
+#define GL_GLEXT_PROTOTYPES 1
+#include <vector>
+#include <map>
+#include <string>
+#include <SDL_opengl.h>
+#include "glm/mat4x4.hpp"
+#include "glm/vec4.hpp"
+
+#define RENDER_MAX_ATTRIBUTES 16
+#define RENDER_MAX_TEXTURE_UNITS 8
+#define RENDER_RECORDED_UNIFORM_BASE 0x10000 // past any location GL hands out
+
+// draw order between kinds of things -- later layers go on top
+enum RenderLayer { RENDER_LAYER_MAP, RENDER_LAYER_ENTITY, RENDER_LAYER_PARTICLES, RENDER_LAYER_LIGHTING, RENDER_LAYER_TEXT };
+
+// how a draw combines with what is already there -- everything leaves BLEND_ALPHA set when done
+enum BlendMode { BLEND_NONE, BLEND_ALPHA, BLEND_ADDITIVE, BLEND_MULTIPLY };
+
+/*
+* Everything the render paths (ShaderProgram uniforms, Map::render,
+* Entity::render, Utility::draw_text) send to the GPU goes through here
+* Resource creation (textures, shader compiles) still talks to GL directly
+*/
+class RenderBackend
+{
+private:
+    static RenderBackend* s_backend;
+
+public:
+    virtual ~RenderBackend() {}
+
+    virtual void  use_program(GLuint program_id) = 0;
+    virtual GLint get_uniform_location(GLuint program_id, const char* name) = 0;
+    virtual void  set_uniform_matrix(GLint location, const glm::mat4& matrix) = 0;
+    virtual void  set_uniform_vec4(GLint location, float x, float y, float z, float w) = 0;
+    virtual void  set_uniform_vec2(GLint location, float x, float y) = 0;
+    virtual void  set_uniform_int(GLint location, int value) = 0;
+    virtual void  set_uniform_float(GLint location, float value) = 0;
+
+    virtual void bind_texture(GLenum target, GLuint texture_id, int unit) = 0;
+
+    // points an attribute at client memory and enables it
+    virtual void set_attribute(GLuint attribute, int size, GLenum type, bool normalised, int stride, const void* data) = 0;
+    virtual void disable_attribute(GLuint attribute) = 0;
+
+    // every mesh is quads drawn with Utility::get_quad_indices -- 4 vertices per quad
+    virtual void draw_quads(int quad_count) = 0;
+
+    virtual void bind_framebuffer(GLuint framebuffer) = 0;
+    virtual void clear() = 0;
+    virtual void clear_to_colour(const glm::vec4& colour) = 0; // the clear colour used by clear() is kept
+    virtual void set_blend_mode(BlendMode mode) = 0;
+
+    // only matters to backends that reorder draws (RenderQueue)
+    virtual void set_layer(RenderLayer layer, int depth = 0) {}
+
+    static RenderBackend* get() { return s_backend; }
+    static void set(RenderBackend* backend) { s_backend = backend; }
+};
+
+// straight through to OpenGL -- the default, g_gl_render_backend
+class GLRenderBackend : public RenderBackend
+{
+public:
+    void  use_program(GLuint program_id) override;
+    GLint get_uniform_location(GLuint program_id, const char* name) override;
+    void  set_uniform_matrix(GLint location, const glm::mat4& matrix) override;
+    void  set_uniform_vec4(GLint location, float x, float y, float z, float w) override;
+    void  set_uniform_vec2(GLint location, float x, float y) override;
+    void  set_uniform_int(GLint location, int value) override;
+    void  set_uniform_float(GLint location, float value) override;
+
+    void bind_texture(GLenum target, GLuint texture_id, int unit) override;
+
+    void set_attribute(GLuint attribute, int size, GLenum type, bool normalised, int stride, const void* data) override;
+    void disable_attribute(GLuint attribute) override;
+
+    void draw_quads(int quad_count) override;
+
+    void bind_framebuffer(GLuint framebuffer) override;
+    void clear() override;
+    void clear_to_colour(const glm::vec4& colour) override;
+    void set_blend_mode(BlendMode mode) override;
+};
+
+extern GLRenderBackend g_gl_render_backend;
+
+enum RenderCommandType { COMMAND_USE_PROGRAM, COMMAND_SET_UNIFORM, COMMAND_BIND_TEXTURE, COMMAND_SET_ATTRIBUTE, COMMAND_DISABLE_ATTRIBUTE, COMMAND_DRAW,
+                         COMMAND_BIND_FRAMEBUFFER, COMMAND_CLEAR, COMMAND_SET_BLEND_MODE };
+
+struct RenderCommand
+{
+    RenderCommandType type;
+    GLuint id;    // program, uniform location, texture or attribute
+    int    value; // texture unit, attribute size or quad count
+    int    bytes; // vertex bytes read by a draw
+};
+
+struct RenderStats
+{
+    int draw_calls = 0;
+    int quads = 0;
+    int program_changes = 0;
+    int texture_changes = 0;
+    int uniform_updates = 0;
+    int vertex_bytes = 0;
+    int index_bytes = 0;
+    int framebuffer_changes = 0;
+};
+
+/*
+* Records what would have been sent to GL without calling it, so the
+* submission path can be measured with no context
+* With store_commands off it only keeps the totals -- a null backend
+*/
+class RecordingRenderBackend : public RenderBackend
+{
+private:
+    bool m_store_commands;
+
+    // state, so only real changes are counted
+    GLuint m_program_id = 0;
+    GLuint m_textures[RENDER_MAX_TEXTURE_UNITS] = { 0 };
+    int    m_attribute_bytes[RENDER_MAX_ATTRIBUTES] = { 0 }; // bytes per vertex of each enabled attribute
+
+    std::vector<RenderCommand> m_commands;
+    RenderStats m_stats;
+    std::map<std::string, GLint> m_uniform_locations; // made up, see get_uniform_location
+
+    void record(RenderCommandType type, GLuint id, int value, int bytes);
+
+public:
+    RecordingRenderBackend(bool store_commands = true);
+
+    void  use_program(GLuint program_id) override;
+    GLint get_uniform_location(GLuint program_id, const char* name) override;
+    void  set_uniform_matrix(GLint location, const glm::mat4& matrix) override;
+    void  set_uniform_vec4(GLint location, float x, float y, float z, float w) override;
+    void  set_uniform_vec2(GLint location, float x, float y) override;
+    void  set_uniform_int(GLint location, int value) override;
+    void  set_uniform_float(GLint location, float value) override;
+
+    void bind_texture(GLenum target, GLuint texture_id, int unit) override;
+
+    void set_attribute(GLuint attribute, int size, GLenum type, bool normalised, int stride, const void* data) override;
+    void disable_attribute(GLuint attribute) override;
+
+    void draw_quads(int quad_count) override;
+
+    void bind_framebuffer(GLuint framebuffer) override;
+    void clear() override;
+    void clear_to_colour(const glm::vec4& colour) override;
+    void set_blend_mode(BlendMode mode) override;
+
+    void reset();
+
+    std::vector<RenderCommand> const& get_commands() const { return m_commands; }
+    RenderStats                const  get_stats()    const { return m_stats; }
+};
@@ -0,0 +1,118 @@
+#include "RenderCache.h"
+#include "RenderBackend.h"
+#include "TextureLoader.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+RenderCache::~RenderCache()
+{
+    if (m_texture_id != 0) glDeleteTextures(1, &m_texture_id);
+    if (m_framebuffer != 0) glDeleteFramebuffers(1, &m_framebuffer);
+}
+
+/*
+* (Re)creates the framebuffer and its colour texture at the viewport size
+*
+* @param width, height, viewport size in pixels
+*/
+void RenderCache::create(int width, int height)
+{
+    if (m_texture_id != 0) glDeleteTextures(1, &m_texture_id);
+    if (m_framebuffer == 0) glGenFramebuffers(1, &m_framebuffer);
+
+    glGenTextures(1, &m_texture_id);
+    glBindTexture(GL_TEXTURE_2D, m_texture_id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+    // one texel per pixel, so nearest keeps the copy exact
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    GLint previous_framebuffer;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture_id, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer);
+
+    m_width = width;
+    m_height = height;
+}
+
+/*
+* Checks whether the cached frame can still be used
+* If not, redirects rendering into the cache and clears it
+*
+* @param program, the scene's SHADERPROGRAM -- its view matrix is the camera
+* @param content_revision, changes whenever what the scene draws changes
+* @return true if the scene has to be drawn (then call end() after)
+*/
+bool RenderCache::begin(ShaderProgram* program, unsigned int content_revision)
+{
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    if (viewport[2] != m_width || viewport[3] != m_height) m_is_valid = false;
+    if (program->get_view_matrix() != m_view_matrix) m_is_valid = false;
+    if (content_revision != m_content_revision) m_is_valid = false;
+    unsigned int texture_generation = TextureLoader::get()->get_upload_generation();
+    if (texture_generation != m_texture_generation) m_is_valid = false;
+    if (m_is_valid) return false;
+
+    if (m_framebuffer == 0 || viewport[2] != m_width || viewport[3] != m_height) create(viewport[2], viewport[3]);
+    m_view_matrix = program->get_view_matrix();
+    m_content_revision = content_revision;
+    m_texture_generation = texture_generation;
+
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_previous_framebuffer);
+    RenderBackend::get()->bind_framebuffer(m_framebuffer);
+    if (m_has_clear_colour) RenderBackend::get()->clear_to_colour(m_clear_colour);
+    else RenderBackend::get()->clear();
+
+    return true;
+}
+
+/*
+* Stops rendering into the cache
+*/
+void RenderCache::end()
+{
+    RenderBackend::get()->bind_framebuffer(m_previous_framebuffer);
+    m_is_valid = true;
+}
+
+/*
+* Draws the cached frame as one quad covering the viewport
+* By default the cache already holds the cleared background, so it
+* replaces what is there instead of blending over it
+*
+* @param program, the textured SHADERPROGRAM
+* @param blend_mode, how the frame combines with the viewport (see Lighting)
+*/
+void RenderCache::present(ShaderProgram* program, BlendMode blend_mode)
+{
+    // undo the camera so the quad lands on the whole viewport
+    glm::mat4 model_matrix = glm::inverse(program->get_projection_matrix() * program->get_view_matrix());
+    model_matrix = glm::scale(model_matrix, glm::vec3(2.0f, 2.0f, 1.0f));
+    program->set_model_matrix(model_matrix);
+
+    // framebuffer rows start at the bottom, so v goes up here
+    static const float vertices[] = {
+        -0.5,  0.5, 0.0, 1.0,
+        -0.5, -0.5, 0.0, 0.0,
+         0.5, -0.5, 1.0, 0.0,
+         0.5,  0.5, 1.0, 1.0
+    };
+
+    RenderBackend* backend = RenderBackend::get();
+    backend->bind_texture(GL_TEXTURE_2D, m_texture_id, 0);
+    backend->set_attribute(program->get_position_attribute(), 2, GL_FLOAT, false, 4 * sizeof(float), vertices);
+    backend->set_attribute(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 4 * sizeof(float), vertices + 2);
+
+    backend->set_blend_mode(blend_mode);
+    backend->draw_quads(1);
+    backend->set_blend_mode(BLEND_ALPHA);
+
+    backend->disable_attribute(program->get_position_attribute());
+    backend->disable_attribute(program->get_tex_coordinate_attribute());
+}
@@ -0,0 +1,56 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include "glm/mat4x4.hpp"
+#include "ShaderProgram.h"
+#include "RenderBackend.h"
+
+/*
+* Keeps a rendered frame in a texture so a scene that doesn't move only
+* has to be drawn once
+*
+*   if (m_render_cache.begin(program, m_state.map->get_revision()))
+*   {
+*       ... draw the scene ...
+*       m_render_cache.end();
+*   }
+*   m_render_cache.present(program);
+*
+* The cache redraws when the viewport size, the camera or the content revision
+* (e.g. Map::get_revision) changes, when TextureLoader uploads a texture (the
+* frame may have been drawn with its placeholder), or after invalidate()
+*/
+class RenderCache
+{
+private:
+    GLuint m_framebuffer = 0;
+    GLuint m_texture_id = 0;
+    GLint  m_previous_framebuffer = 0;
+
+    int m_width = 0;
+    int m_height = 0;
+    glm::mat4 m_view_matrix = glm::mat4(1.0f);
+    unsigned int m_content_revision = 0;
+    unsigned int m_texture_generation = 0;
+    bool m_is_valid = false;
+
+    glm::vec4 m_clear_colour = glm::vec4(0.0f);
+    bool m_has_clear_colour = false; // otherwise the current GL clear colour
+
+    void create(int width, int height);
+
+public:
+    ~RenderCache();
+
+    bool begin(ShaderProgram* program, unsigned int content_revision);
+    void end();
+    void present(ShaderProgram* program, BlendMode blend_mode = BLEND_NONE);
+    void invalidate() { m_is_valid = false; }
+    void set_clear_colour(const glm::vec4& colour) { m_clear_colour = colour; m_has_clear_colour = true; }
+};
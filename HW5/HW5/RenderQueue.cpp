@@ -0,0 +1,410 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include <cstring>
+
+/*
+* Starts collecting a frame -- the queue stands in for the current backend
+* until end()
+*/
+void RenderQueue::begin()
+{
+    m_target = RenderBackend::get();
+    RenderBackend::set(this);
+
+    m_layer = 0;
+    m_depth = 0;
+    reset_state();
+}
+
+/*
+* Draws everything queued and hands the previous backend back
+*/
+void RenderQueue::end()
+{
+    flush();
+    RenderBackend::set(m_target);
+}
+
+/*
+* Forgets the bound state on both sides -- anything may have been
+* changed directly on the target between frames
+*/
+void RenderQueue::reset_state()
+{
+    m_program_id = 0;
+    m_replay_program_id = 0;
+    m_uniforms.clear();
+    m_replay_uniforms.clear();
+
+    // every caller leaves alpha blending set
+    m_blend_mode = BLEND_ALPHA;
+    m_replay_blend_mode = BLEND_ALPHA;
+    for (int i = 0; i < RENDER_MAX_TEXTURE_UNITS; i++)
+    {
+        m_textures[i] = { GL_TEXTURE_2D, 0 };
+        m_replay_textures[i] = { GL_TEXTURE_2D, 0 };
+    }
+    for (int i = 0; i < RENDER_MAX_ATTRIBUTES; i++) m_attributes[i] = AttributeState();
+}
+
+void RenderQueue::set_layer(RenderLayer layer, int depth)
+{
+    m_layer = (int)layer;
+    m_depth = depth;
+}
+
+// ----- STATE ----- //
+
+void RenderQueue::use_program(GLuint program_id)
+{
+    m_program_id = program_id;
+}
+
+GLint RenderQueue::get_uniform_location(GLuint program_id, const char* name)
+{
+    return m_target->get_uniform_location(program_id, name);
+}
+
+/*
+* Keeps a uniform's new value for the bound program -- draws queued from
+* here on carry it
+* A draw queued before a uniform's first value this frame relies on what the
+* target already has, and that would be lost if the draw were sorted after the
+* change, so the first value of a uniform flushes any draws using its program
+*
+* @param location, the uniform
+* @param values, components floats, or NULL for an int uniform
+* @param components, 16, 4, 2 or 1 floats, or 0 for an int
+* @param int_value, the value of an int uniform
+*/
+void RenderQueue::queue_uniform(GLint location, const float* values, int components, int int_value)
+{
+    bool is_new = true;
+    for (const QueuedUniform& uniform : m_uniforms) is_new = is_new && (uniform.program_id != m_program_id || uniform.location != location);
+
+    bool is_program_queued = false;
+    for (int i = 0; is_new && i < (int)m_items.size() && !is_program_queued; i++) is_program_queued = m_items[i].program_id == m_program_id;
+    if (is_program_queued) flush();
+
+    QueuedUniform uniform = { m_program_id, location, components, int_value };
+    if (components > 0)
+    {
+        uniform.data = (int)m_uniform_data.size();
+        m_uniform_data.insert(m_uniform_data.end(), values, values + components);
+    }
+    store_uniform(m_uniforms, uniform);
+}
+
+// replaces the program's value of the uniform, or adds it
+void RenderQueue::store_uniform(std::vector<QueuedUniform>& uniforms, const QueuedUniform& uniform)
+{
+    for (QueuedUniform& stored : uniforms)
+    {
+        if (stored.program_id != uniform.program_id || stored.location != uniform.location) continue;
+        stored = uniform;
+        return;
+    }
+    uniforms.push_back(uniform);
+}
+
+bool RenderQueue::is_same_uniform(const QueuedUniform& a, const QueuedUniform& b) const
+{
+    if (a.program_id != b.program_id || a.location != b.location || a.components != b.components) return false;
+    if (a.components == 0) return a.data == b.data;
+    return memcmp(&m_uniform_data[a.data], &m_uniform_data[b.data], a.components * sizeof(float)) == 0;
+}
+
+void RenderQueue::set_uniform_matrix(GLint location, const glm::mat4& matrix)
+{
+    queue_uniform(location, &matrix[0][0], 16, 0);
+}
+
+void RenderQueue::set_uniform_vec4(GLint location, float x, float y, float z, float w)
+{
+    float values[] = { x, y, z, w };
+    queue_uniform(location, values, 4, 0);
+}
+
+void RenderQueue::set_uniform_vec2(GLint location, float x, float y)
+{
+    float values[] = { x, y };
+    queue_uniform(location, values, 2, 0);
+}
+
+void RenderQueue::set_uniform_int(GLint location, int value)
+{
+    queue_uniform(location, NULL, 0, value);
+}
+
+void RenderQueue::set_uniform_float(GLint location, float value)
+{
+    queue_uniform(location, &value, 1, 0);
+}
+
+// not a barrier -- recorded with each draw and only changed on the target when it differs
+void RenderQueue::set_blend_mode(BlendMode mode)
+{
+    m_blend_mode = mode;
+}
+
+void RenderQueue::bind_texture(GLenum target, GLuint texture_id, int unit)
+{
+    if (unit < 0 || unit >= RENDER_MAX_TEXTURE_UNITS) return;
+    m_textures[unit] = { target, texture_id };
+}
+
+void RenderQueue::set_attribute(GLuint attribute, int size, GLenum type, bool normalised, int stride, const void* data)
+{
+    if (attribute >= RENDER_MAX_ATTRIBUTES) return;
+
+    AttributeState& state = m_attributes[attribute];
+    state.is_enabled = true;
+    state.size = size;
+    state.type = type;
+    state.normalised = normalised;
+    state.stride = stride;
+    state.data = data;
+}
+
+void RenderQueue::disable_attribute(GLuint attribute)
+{
+    if (attribute >= RENDER_MAX_ATTRIBUTES) return;
+    m_attributes[attribute].is_enabled = false;
+}
+
+// ----- DRAWING ----- //
+
+/*
+* Queues a draw with a snapshot of the bound program, its uniforms, the
+* textures and attributes, and copies the vertices it reads
+*
+* @param quad_count, number of quads, 4 vertices each
+*/
+void RenderQueue::draw_quads(int quad_count)
+{
+    if (quad_count <= 0) return;
+
+    RenderItem item;
+    item.program_id = m_program_id;
+    for (int i = 0; i < RENDER_MAX_TEXTURE_UNITS; i++) item.textures[i] = m_textures[i];
+    item.first_uniform = (int)m_item_uniforms.size();
+    for (const QueuedUniform& uniform : m_uniforms)
+    {
+        if (uniform.program_id == m_program_id) m_item_uniforms.push_back(uniform);
+    }
+    item.uniform_count = (int)m_item_uniforms.size() - item.first_uniform;
+    item.first_attribute = (int)m_queued_attributes.size();
+    item.quad_count = quad_count;
+    item.blend_mode = m_blend_mode;
+
+    int vertex_count = quad_count * 4;
+    for (int i = 0; i < RENDER_MAX_ATTRIBUTES; i++)
+    {
+        AttributeState& state = m_attributes[i];
+        if (!state.is_enabled) continue;
+
+        int component_bytes = 4;
+        if (state.type == GL_SHORT || state.type == GL_UNSIGNED_SHORT) component_bytes = 2;
+        else if (state.type == GL_BYTE || state.type == GL_UNSIGNED_BYTE) component_bytes = 1;
+
+        // only the bytes this attribute reads -- the last vertex needn't fill a whole stride
+        int element_bytes = state.size * component_bytes;
+        int stride = state.stride != 0 ? state.stride : element_bytes;
+        int bytes = stride * (vertex_count - 1) + element_bytes;
+
+        // keep every copy 4 byte aligned
+        int offset = ((int)m_vertex_data.size() + 3) & ~3;
+        m_vertex_data.resize(offset + bytes);
+        memcpy(&m_vertex_data[offset], state.data, bytes);
+
+        m_queued_attributes.push_back({ (GLuint)i, state.size, state.type, state.normalised, stride, offset });
+    }
+    item.attribute_count = (int)m_queued_attributes.size() - item.first_attribute;
+
+    uint64_t depth = (uint64_t)std::min(std::max(m_depth + 0x8000, 0), 0xFFFF);
+    uint64_t key = ((uint64_t)(m_layer & 0xFF) << RENDER_KEY_LAYER_SHIFT) |
+        ((uint64_t)(item.program_id & 0xFFF) << RENDER_KEY_PROGRAM_SHIFT) |
+        ((uint64_t)(item.textures[0].texture_id & 0xFFFFF) << RENDER_KEY_TEXTURE_SHIFT) |
+        (depth << RENDER_KEY_DEPTH_SHIFT);
+
+    m_items.push_back(item);
+    m_keys.push_back(key);
+}
+
+/*
+* Stable LSD radix sort of the queued draws on their keys, one byte per
+* pass -- passes where every key has the same byte are skipped, which is
+* most of them since only a few layers, programs and textures are in use
+*/
+void RenderQueue::sort()
+{
+    int count = (int)m_keys.size();
+    m_sort_entries.resize(count);
+    m_sort_scratch.resize(count);
+    for (int i = 0; i < count; i++) m_sort_entries[i] = { m_keys[i], i };
+
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        int offsets[256] = { 0 };
+        for (int i = 0; i < count; i++) offsets[(m_sort_entries[i].key >> shift) & 0xFF]++;
+
+        if (offsets[(m_sort_entries[0].key >> shift) & 0xFF] == count) continue;
+
+        int offset = 0;
+        for (int bucket = 0; bucket < 256; bucket++)
+        {
+            int bucket_count = offsets[bucket];
+            offsets[bucket] = offset;
+            offset += bucket_count;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            m_sort_scratch[offsets[(m_sort_entries[i].key >> shift) & 0xFF]++] = m_sort_entries[i];
+        }
+        m_sort_entries.swap(m_sort_scratch);
+    }
+}
+
+/*
+* Sets a uniform on the target, unless it already has that value
+*
+* @param uniform, the program, uniform and value
+*/
+void RenderQueue::replay_uniform(const QueuedUniform& uniform)
+{
+    for (const QueuedUniform& replayed : m_replay_uniforms)
+    {
+        if (replayed.program_id == uniform.program_id && replayed.location == uniform.location && is_same_uniform(replayed, uniform)) return;
+    }
+    store_uniform(m_replay_uniforms, uniform);
+
+    // uniforms go to the program that is bound
+    if (uniform.program_id != m_replay_program_id)
+    {
+        m_replay_program_id = uniform.program_id;
+        m_target->use_program(uniform.program_id);
+    }
+
+    if (uniform.components == 0)
+    {
+        m_target->set_uniform_int(uniform.location, uniform.data);
+        return;
+    }
+
+    const float* values = m_uniform_data.data() + uniform.data;
+    switch (uniform.components)
+    {
+    case 16: m_target->set_uniform_matrix(uniform.location, *(const glm::mat4*)values); break;
+    case 4:  m_target->set_uniform_vec4(uniform.location, values[0], values[1], values[2], values[3]); break;
+    case 2:  m_target->set_uniform_vec2(uniform.location, values[0], values[1]); break;
+    default: m_target->set_uniform_float(uniform.location, values[0]); break;
+    }
+}
+
+/*
+* Sorts and replays everything queued so far, skipping program and
+* texture binds the target already has
+*/
+void RenderQueue::flush()
+{
+    if (!m_items.empty())
+    {
+        sort();
+
+        for (RenderSortEntry& entry : m_sort_entries)
+        {
+            RenderItem& item = m_items[entry.item];
+
+            if (item.program_id != m_replay_program_id)
+            {
+                m_replay_program_id = item.program_id;
+                m_target->use_program(item.program_id);
+            }
+
+            for (int i = item.first_uniform; i < item.first_uniform + item.uniform_count; i++) replay_uniform(m_item_uniforms[i]);
+
+            for (int unit = 0; unit < RENDER_MAX_TEXTURE_UNITS; unit++)
+            {
+                QueuedTexture& texture = item.textures[unit];
+                QueuedTexture& bound = m_replay_textures[unit];
+                if (texture.texture_id == 0) continue;
+                if (texture.texture_id == bound.texture_id && texture.target == bound.target) continue;
+
+                bound = texture;
+                m_target->bind_texture(texture.target, texture.texture_id, unit);
+            }
+
+            for (int i = item.first_attribute; i < item.first_attribute + item.attribute_count; i++)
+            {
+                QueuedAttribute& attribute = m_queued_attributes[i];
+                m_target->set_attribute(attribute.attribute, attribute.size, attribute.type, attribute.normalised,
+                    attribute.stride, &m_vertex_data[attribute.offset]);
+            }
+
+            if (item.blend_mode != m_replay_blend_mode)
+            {
+                m_replay_blend_mode = item.blend_mode;
+                m_target->set_blend_mode(item.blend_mode);
+            }
+
+            m_target->draw_quads(item.quad_count);
+
+            for (int i = item.first_attribute; i < item.first_attribute + item.attribute_count; i++)
+            {
+                m_target->disable_attribute(m_queued_attributes[i].attribute);
+            }
+        }
+    }
+
+    // the target ends up with the uniforms, program and blend mode the callers last asked for
+    for (const QueuedUniform& uniform : m_uniforms) replay_uniform(uniform);
+    if (m_program_id != 0 && m_program_id != m_replay_program_id)
+    {
+        m_replay_program_id = m_program_id;
+        m_target->use_program(m_program_id);
+    }
+    if (m_blend_mode != m_replay_blend_mode)
+    {
+        m_replay_blend_mode = m_blend_mode;
+        m_target->set_blend_mode(m_blend_mode);
+    }
+
+    // the latest values are all that is still needed -- both sides now share them
+    std::vector<float> uniform_data;
+    for (QueuedUniform& uniform : m_uniforms)
+    {
+        if (uniform.components == 0) continue;
+        int data = (int)uniform_data.size();
+        uniform_data.insert(uniform_data.end(), m_uniform_data.begin() + uniform.data, m_uniform_data.begin() + uniform.data + uniform.components);
+        uniform.data = data;
+    }
+    m_uniform_data.swap(uniform_data);
+    m_replay_uniforms = m_uniforms;
+
+    m_item_uniforms.clear();
+    m_queued_attributes.clear();
+    m_vertex_data.clear();
+    m_items.clear();
+    m_keys.clear();
+}
+
+// ----- BARRIERS ----- //
+
+void RenderQueue::bind_framebuffer(GLuint framebuffer)
+{
+    flush();
+    m_target->bind_framebuffer(framebuffer);
+}
+
+void RenderQueue::clear()
+{
+    flush();
+    m_target->clear();
+}
+
+void RenderQueue::clear_to_colour(const glm::vec4& colour)
+{
+    flush();
+    m_target->clear_to_colour(colour);
+}
@@ -0,0 +1,157 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+
+#define GL_GLEXT_PROTOTYPES 1
+#include <vector>
+#include <cstdint>
+#include <SDL_opengl.h>
+#include "RenderBackend.h"
+
+// ----- SORT KEY ----- //
+// high to low: layer | program | texture on unit 0 | depth
+#define RENDER_KEY_LAYER_SHIFT   56
+#define RENDER_KEY_PROGRAM_SHIFT 44
+#define RENDER_KEY_TEXTURE_SHIFT 24
+#define RENDER_KEY_DEPTH_SHIFT   8
+
+// the value one uniform of one program has
+struct QueuedUniform
+{
+    GLuint program_id;
+    GLint  location;
+    int    components; // 16, 4, 2 or 1 floats, or 0 for an int
+    int    data;       // offset into the uniform data, or the int itself
+};
+
+struct QueuedAttribute
+{
+    GLuint attribute;
+    int    size;
+    GLenum type;
+    bool   normalised;
+    int    stride;
+    int    offset; // into the copied vertex data
+};
+
+struct QueuedTexture
+{
+    GLenum target;
+    GLuint texture_id;
+};
+
+// one draw and the state it was submitted with
+struct RenderItem
+{
+    GLuint        program_id;
+    QueuedTexture textures[RENDER_MAX_TEXTURE_UNITS];
+    int           first_uniform, uniform_count; // every uniform of its program set this frame
+    int           first_attribute, attribute_count;
+    int           quad_count;
+    BlendMode     blend_mode;
+};
+
+struct RenderSortEntry
+{
+    uint64_t key;
+    int      item;
+};
+
+/*
+* Collects a frame's draws instead of sending them straight away, then
+* radix sorts them by key and replays them to the real backend, so draws
+* sharing a program and texture end up next to each other
+*
+*   queue.begin();      // becomes RenderBackend::get()
+*   ... render ...      // set_layer() picks where each draw goes
+*   queue.end();        // sorts, replays, puts the old backend back
+*
+* Vertex data is copied when a draw is queued, so callers may free it
+* straight after. The blend mode is part of each draw's state, so a
+* multiplied layer can sit between the others. So are the program's
+* uniforms -- each draw keeps the value of every uniform its program was
+* given this frame, and the replay sets whichever differ from what the
+* target has, so a draw sorted ahead of a uniform change still sees the
+* values it was submitted with. Framebuffer and clear changes can't be
+* reordered -- they flush everything queued so far first.
+*/
+class RenderQueue : public RenderBackend
+{
+private:
+    RenderBackend* m_target = NULL;
+
+    int m_layer = 0;
+    int m_depth = 0;
+
+    // what the callers think is bound
+    struct AttributeState
+    {
+        bool        is_enabled = false;
+        int         size = 0;
+        GLenum      type = GL_FLOAT;
+        bool        normalised = false;
+        int         stride = 0;
+        const void* data = NULL;
+    };
+    GLuint         m_program_id = 0;
+    BlendMode      m_blend_mode = BLEND_ALPHA;
+    QueuedTexture  m_textures[RENDER_MAX_TEXTURE_UNITS];
+    AttributeState m_attributes[RENDER_MAX_ATTRIBUTES];
+    std::vector<QueuedUniform> m_uniforms; // latest value of every uniform set since the last flush
+
+    // what the target really has bound while replaying
+    GLuint        m_replay_program_id = 0;
+    BlendMode     m_replay_blend_mode = BLEND_ALPHA;
+    QueuedTexture m_replay_textures[RENDER_MAX_TEXTURE_UNITS];
+    std::vector<QueuedUniform> m_replay_uniforms;
+
+    // the frame so far
+    std::vector<float>           m_uniform_data;
+    std::vector<QueuedUniform>   m_item_uniforms;
+    std::vector<QueuedAttribute> m_queued_attributes;
+    std::vector<unsigned char>   m_vertex_data;
+    std::vector<RenderItem>      m_items;
+    std::vector<uint64_t>        m_keys;
+
+    std::vector<RenderSortEntry> m_sort_entries;
+    std::vector<RenderSortEntry> m_sort_scratch;
+
+    void reset_state();
+    void queue_uniform(GLint location, const float* values, int components, int int_value);
+    void store_uniform(std::vector<QueuedUniform>& uniforms, const QueuedUniform& uniform);
+    bool is_same_uniform(const QueuedUniform& a, const QueuedUniform& b) const;
+    void replay_uniform(const QueuedUniform& uniform);
+    void sort();
+    void flush();
+
+public:
+    void begin();
+    void end();
+
+    void set_layer(RenderLayer layer, int depth = 0) override;
+
+    void  use_program(GLuint program_id) override;
+    GLint get_uniform_location(GLuint program_id, const char* name) override;
+    void  set_uniform_matrix(GLint location, const glm::mat4& matrix) override;
+    void  set_uniform_vec4(GLint location, float x, float y, float z, float w) override;
+    void  set_uniform_vec2(GLint location, float x, float y) override;
+    void  set_uniform_int(GLint location, int value) override;
+    void  set_uniform_float(GLint location, float value) override;
+
+    void bind_texture(GLenum target, GLuint texture_id, int unit) override;
+
+    void set_attribute(GLuint attribute, int size, GLenum type, bool normalised, int stride, const void* data) override;
+    void disable_attribute(GLuint attribute) override;
+
+    void draw_quads(int quad_count) override;
+
+    void bind_framebuffer(GLuint framebuffer) override;
+    void clear() override;
+    void clear_to_colour(const glm::vec4& colour) override;
+    void set_blend_mode(BlendMode mode) override;
+
+    int const get_item_count() const { return (int)m_items.size(); }
+};
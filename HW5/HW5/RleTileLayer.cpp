@@ -0,0 +1,123 @@
+#include "RleTileLayer.h"
+#include <algorithm>
+
+void RleTileLayer::clear_cache()
+{
+    for (int i = 0; i < RLE_ROW_CACHE_SIZE; i++) m_cached_rows[i] = -1;
+}
+
+/*
+* Run-length encodes a dense layer into memory of its own
+*
+* @param width, height, layer size in tiles
+* @param tiles, width * height tile ids, row by row
+*/
+void RleTileLayer::encode(int width, int height, const unsigned int* tiles)
+{
+    m_width = width;
+    m_height = height;
+
+    m_owned_row_offsets.clear();
+    m_owned_runs.clear();
+    for (int y = 0; y < height; y++)
+    {
+        m_owned_row_offsets.push_back((uint32_t)m_owned_runs.size());
+
+        const unsigned int* row = tiles + (size_t)y * width;
+        for (int x = 0; x < width; x++)
+        {
+            if (x > 0 && row[x] == row[x - 1]) m_owned_runs.back().length++;
+            else m_owned_runs.push_back({ row[x], 1 });
+        }
+    }
+    m_owned_row_offsets.push_back((uint32_t)m_owned_runs.size());
+
+    m_row_offsets = m_owned_row_offsets.data();
+    m_runs = m_owned_runs.data();
+    clear_cache();
+}
+
+/*
+* Reads an already encoded layer in place, e.g. out of a mapped level file
+*
+* @param width, height, layer size in tiles
+* @param row_offsets, height + 1 indices into runs -- row y is runs[row_offsets[y]] up to runs[row_offsets[y + 1]]
+* @param runs, every row's runs, one row after the other
+*/
+void RleTileLayer::view(int width, int height, const uint32_t* row_offsets, const TileRun* runs)
+{
+    m_width = width;
+    m_height = height;
+
+    m_owned_row_offsets.clear();
+    m_owned_runs.clear();
+    m_row_offsets = row_offsets;
+    m_runs = runs;
+    clear_cache();
+}
+
+/*
+* Decodes part of one row -- only reads the layer, so it is safe from any thread
+* Runs that would go past the end of the row are cut short
+*
+* @param y, the row
+* @param first_x, count, which tiles of the row
+* @param tiles, count tile ids out
+*/
+void RleTileLayer::read_row(int y, int first_x, int count, unsigned int* tiles) const
+{
+    int last_x = first_x + count;
+    int x = 0;
+    for (uint32_t i = m_row_offsets[y]; i < m_row_offsets[y + 1] && x < last_x; i++)
+    {
+        int run_end = (int)std::min<uint32_t>((uint32_t)x + m_runs[i].length, (uint32_t)last_x);
+        if (run_end > first_x) std::fill(tiles + std::max(x - first_x, 0), tiles + (run_end - first_x), m_runs[i].tile);
+        x = run_end;
+    }
+
+    // a row with too few runs reads as empty past its end
+    if (x < last_x) std::fill(tiles + std::max(x - first_x, 0), tiles + count, 0u);
+}
+
+/*
+* One tile, through the cache of decoded rows
+* Rows are decoded RLE_ROW_CACHE_SPAN tiles at a time, so a miss costs the
+* runs up to x rather than the whole row. Half the slots hold even spans and
+* half odd ones, so a box of rows across a span boundary all stays cached
+* Main thread only, since the cache is shared
+*
+* @param x, y, tile position, which has to be inside the layer
+*/
+unsigned int RleTileLayer::get_tile(int x, int y) const
+{
+    int span = x / RLE_ROW_CACHE_SPAN;
+    int slot = y % (RLE_ROW_CACHE_SIZE / 2) + (span & 1) * (RLE_ROW_CACHE_SIZE / 2);
+
+    if (m_cached_rows[slot] != y || m_cached_spans[slot] != span)
+    {
+        int first_x = span * RLE_ROW_CACHE_SPAN;
+        read_row(y, first_x, std::min(RLE_ROW_CACHE_SPAN, m_width - first_x), m_cached_tiles[slot]);
+        m_cached_rows[slot] = y;
+        m_cached_spans[slot] = span;
+    }
+
+    return m_cached_tiles[slot][x - span * RLE_ROW_CACHE_SPAN];
+}
+
+/*
+* How many bytes encode() would use, without encoding
+*
+* @param width, height, layer size in tiles
+* @param tiles, width * height tile ids, row by row
+*/
+size_t RleTileLayer::get_encoded_size(int width, int height, const unsigned int* tiles)
+{
+    size_t run_count = 0;
+    for (int y = 0; y < height; y++)
+    {
+        const unsigned int* row = tiles + (size_t)y * width;
+        for (int x = 0; x < width; x++) run_count += x == 0 || row[x] != row[x - 1];
+    }
+
+    return (height + 1) * sizeof(uint32_t) + run_count * sizeof(TileRun);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#define RLE_ROW_CACHE_SIZE 16 // decoded pieces of rows kept for get_tile()
+#define RLE_ROW_CACHE_SPAN 64 // tiles in each piece
+
+// length tiles in a row with the same id
+struct TileRun
+{
+    uint32_t tile;
+    uint32_t length;
+};
+
+/*
+* A tile layer stored as runs of the same tile, row by row
+*
+* Each row's runs are found through a row index, so reading a tile only
+* decodes the row it is in. get_tile() keeps the last few decoded pieces
+* of rows, so repeated queries around the same place don't decode at all.
+* Its callers are the level compiler and the checks in main.cpp -- the game
+* itself collides with Map's solidity mask and builds from whole rows.
+* Runs never cross rows, and the encoded layer can be read in place out
+* of a mapped level file.
+*/
+class RleTileLayer
+{
+private:
+    int m_width = 0;
+    int m_height = 0;
+
+    const uint32_t* m_row_offsets = NULL; // height + 1 indices into the runs, the last is the run count
+    const TileRun*  m_runs = NULL;
+
+    // only used for layers encoded here rather than viewed in a file
+    std::vector<uint32_t> m_owned_row_offsets;
+    std::vector<TileRun>  m_owned_runs;
+
+    // main thread only -- see get_tile()
+    mutable int          m_cached_rows[RLE_ROW_CACHE_SIZE];  // -1 for an empty slot
+    mutable int          m_cached_spans[RLE_ROW_CACHE_SIZE]; // x / RLE_ROW_CACHE_SPAN
+    mutable unsigned int m_cached_tiles[RLE_ROW_CACHE_SIZE][RLE_ROW_CACHE_SPAN];
+
+    void clear_cache();
+
+public:
+    RleTileLayer() { clear_cache(); }
+
+    // points into its own vectors, so it can't be copied
+    RleTileLayer(const RleTileLayer&) = delete;
+    RleTileLayer& operator=(const RleTileLayer&) = delete;
+
+    void encode(int width, int height, const unsigned int* tiles);
+    void view(int width, int height, const uint32_t* row_offsets, const TileRun* runs);
+
+    void         read_row(int y, int first_x, int count, unsigned int* tiles) const;
+    unsigned int get_tile(int x, int y) const;
+
+    static size_t get_encoded_size(int width, int height, const unsigned int* tiles);
+
+    bool            const is_empty()        const { return m_runs == NULL; }
+    int             const get_run_count()   const { return m_row_offsets == NULL ? 0 : (int)m_row_offsets[m_height]; }
+    size_t          const get_byte_count()  const { return (m_height + 1) * sizeof(uint32_t) + get_run_count() * sizeof(TileRun); }
+    const uint32_t* const get_row_offsets() const { return m_row_offsets; }
+    const TileRun*  const get_runs()        const { return m_runs; }
+};
@@ -0,0 +1,275 @@
+#include "Rope.h"
+#include "Benchmark.h"
+#include "RenderBackend.h"
+#include "Transform2D.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ROPE_USE_SSE
+#include <emmintrin.h>
+#endif
+
+Rope::Rope()
+{
+    m_x.resize(ROPE_PARTICLE_COUNT);
+    m_y.resize(ROPE_PARTICLE_COUNT);
+    m_previous_x.resize(ROPE_PARTICLE_COUNT);
+    m_previous_y.resize(ROPE_PARTICLE_COUNT);
+    m_inverse_mass.resize(ROPE_PARTICLE_COUNT, 1.0f);
+
+    // both ends follow the hook and the player instead of the simulation
+    m_inverse_mass[0] = 0.0f;
+    m_inverse_mass[ROPE_PARTICLE_COUNT - 1] = 0.0f;
+}
+
+/*
+* Lays the rope out in a straight line, at rest
+*
+* @param start, end, positions of the first and last particle
+*/
+void Rope::reset(glm::vec3 start, glm::vec3 end)
+{
+    for (int i = 0; i < ROPE_PARTICLE_COUNT; i++)
+    {
+        float t = (float)i / (ROPE_PARTICLE_COUNT - 1);
+        m_x[i] = m_previous_x[i] = start.x + (end.x - start.x) * t;
+        m_y[i] = m_previous_y[i] = start.y + (end.y - start.y) * t;
+    }
+}
+
+/*
+* Steps the rope -- called once per fixed step, after the scene update
+* While the hook flies the rope pays out behind it; once the hook sticks the
+* player swings from it and the rope reels in
+* The solver runs ROPE_ITERATIONS times, so the rope doesn't depend on how fast the machine is
+*
+* @param delta_time, seconds to advance
+* @param player, the player ENTITY the rope hangs from
+* @param chain, the chain ENTITY -- its position is the hook
+* @param map, the level's MAP the rope collides with
+*/
+void Rope::update(float delta_time, Entity* player, Entity* chain, Map* map)
+{
+    if (!chain->get_active_state())
+    {
+        m_is_active = false;
+        player->is_swinging = false;
+        return;
+    }
+
+    glm::vec3 hook = chain->get_position();
+    glm::vec3 hand = player->get_position();
+
+    if (!m_is_active)
+    {
+        reset(hook, hand);
+        m_is_active = true;
+    }
+
+    if (chain->chain_state == STICK && player->chain_timer > 0.0f)
+    {
+        if (!player->is_swinging) m_length = glm::length(hand - hook);
+        player->is_swinging = true;
+
+        m_length = std::max(ROPE_MIN_LENGTH, m_length - ROPE_REEL_SPEED * delta_time);
+        swing(player, hook);
+        hand = player->get_position();
+    }
+    else
+    {
+        player->is_swinging = false;
+        m_length = glm::length(hand - hook);
+    }
+
+    m_x[0] = m_previous_x[0] = hook.x;
+    m_y[0] = m_previous_y[0] = hook.y;
+    m_x[ROPE_PARTICLE_COUNT - 1] = m_previous_x[ROPE_PARTICLE_COUNT - 1] = hand.x;
+    m_y[ROPE_PARTICLE_COUNT - 1] = m_previous_y[ROPE_PARTICLE_COUNT - 1] = hand.y;
+
+    integrate(delta_time);
+
+    float rest_length = m_length / (ROPE_PARTICLE_COUNT - 1);
+    for (int iteration = 0; iteration < ROPE_ITERATIONS; iteration++)
+    {
+        solve_links(0, rest_length);
+        solve_links(1, rest_length);
+    }
+
+    collide(map);
+}
+
+/*
+* Keeps the player within the rope's length of the anchor
+* Only the velocity pointing away from the anchor is removed, so gravity
+* and the player's input turn into a swing
+*
+* @param player, the player ENTITY
+* @param anchor, where the hook is stuck
+*/
+void Rope::swing(Entity* player, glm::vec3 anchor)
+{
+    glm::vec3 offset = player->get_position() - anchor;
+    float distance = glm::length(offset);
+    if (distance <= m_length || distance == 0.0f) return;
+
+    glm::vec3 direction = offset / distance;
+    player->set_position(anchor + direction * m_length);
+
+    glm::vec3 velocity = player->get_velocity();
+    float outward_speed = glm::dot(velocity, direction);
+    if (outward_speed > 0.0f) player->set_velocity(velocity - direction * outward_speed);
+}
+
+/*
+* Verlet step for the free particles -- velocity is the distance moved last step
+*/
+void Rope::integrate(float delta_time)
+{
+    float gravity_step = ROPE_GRAVITY * delta_time * delta_time;
+
+    for (int i = 1; i < ROPE_PARTICLE_COUNT - 1; i++)
+    {
+        float velocity_x = (m_x[i] - m_previous_x[i]) * ROPE_DAMPING;
+        float velocity_y = (m_y[i] - m_previous_y[i]) * ROPE_DAMPING;
+
+        m_previous_x[i] = m_x[i];
+        m_previous_y[i] = m_y[i];
+
+        m_x[i] += velocity_x;
+        m_y[i] += velocity_y + gravity_step;
+    }
+}
+
+/*
+* Pulls every other link back to its rest length
+* Links first, first + 2, ... share no particles, so they can all move at once
+*
+* @param first, 0 for the even links, 1 for the odd ones
+* @param rest_length, length of one link
+*/
+void Rope::solve_links(int first, float rest_length)
+{
+    float* x = m_x.data();
+    float* y = m_y.data();
+    const float* inverse_mass = m_inverse_mass.data();
+
+    int link = first;
+
+#ifdef ROPE_USE_SSE
+    __m128 rest = _mm_set1_ps(rest_length);
+    __m128 epsilon = _mm_set1_ps(1e-6f);
+
+    // four links -- eight particles -- at a time
+    for (; link + 8 <= ROPE_PARTICLE_COUNT; link += 8)
+    {
+        __m128 x_low = _mm_loadu_ps(x + link), x_high = _mm_loadu_ps(x + link + 4);
+        __m128 y_low = _mm_loadu_ps(y + link), y_high = _mm_loadu_ps(y + link + 4);
+        __m128 w_low = _mm_loadu_ps(inverse_mass + link), w_high = _mm_loadu_ps(inverse_mass + link + 4);
+
+        // split into the start and end particle of each link
+        __m128 ax = _mm_shuffle_ps(x_low, x_high, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 bx = _mm_shuffle_ps(x_low, x_high, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 ay = _mm_shuffle_ps(y_low, y_high, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 by = _mm_shuffle_ps(y_low, y_high, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 wa = _mm_shuffle_ps(w_low, w_high, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 wb = _mm_shuffle_ps(w_low, w_high, _MM_SHUFFLE(3, 1, 3, 1));
+
+        __m128 dx = _mm_sub_ps(bx, ax);
+        __m128 dy = _mm_sub_ps(by, ay);
+        __m128 length = _mm_max_ps(_mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy))), epsilon);
+        __m128 weight = _mm_max_ps(_mm_add_ps(wa, wb), epsilon);
+        __m128 amount = _mm_div_ps(_mm_sub_ps(length, rest), _mm_mul_ps(length, weight));
+
+        ax = _mm_add_ps(ax, _mm_mul_ps(_mm_mul_ps(wa, amount), dx));
+        ay = _mm_add_ps(ay, _mm_mul_ps(_mm_mul_ps(wa, amount), dy));
+        bx = _mm_sub_ps(bx, _mm_mul_ps(_mm_mul_ps(wb, amount), dx));
+        by = _mm_sub_ps(by, _mm_mul_ps(_mm_mul_ps(wb, amount), dy));
+
+        // and back into particle order
+        _mm_storeu_ps(x + link, _mm_unpacklo_ps(ax, bx));
+        _mm_storeu_ps(x + link + 4, _mm_unpackhi_ps(ax, bx));
+        _mm_storeu_ps(y + link, _mm_unpacklo_ps(ay, by));
+        _mm_storeu_ps(y + link + 4, _mm_unpackhi_ps(ay, by));
+    }
+#endif
+
+    for (; link + 1 < ROPE_PARTICLE_COUNT; link += 2)
+    {
+        float dx = x[link + 1] - x[link];
+        float dy = y[link + 1] - y[link];
+        float length = std::max(sqrtf(dx * dx + dy * dy), 1e-6f);
+        float weight = std::max(inverse_mass[link] + inverse_mass[link + 1], 1e-6f);
+        float amount = (length - rest_length) / (length * weight);
+
+        x[link] += inverse_mass[link] * amount * dx;
+        y[link] += inverse_mass[link] * amount * dy;
+        x[link + 1] -= inverse_mass[link + 1] * amount * dx;
+        y[link + 1] -= inverse_mass[link + 1] * amount * dy;
+    }
+}
+
+/*
+* Particles that ended up inside a solid tile go back to where they were
+*/
+void Rope::collide(Map* map)
+{
+    float penetration_x = 0;
+    float penetration_y = 0;
+
+    for (int i = 1; i < ROPE_PARTICLE_COUNT - 1; i++)
+    {
+        if (!map->is_solid(glm::vec3(m_x[i], m_y[i], 0.0f), &penetration_x, &penetration_y)) continue;
+
+        m_x[i] = m_previous_x[i];
+        m_y[i] = m_previous_y[i];
+    }
+}
+
+/*
+* Draws the links as one batch of quads
+*
+* @param program, the textured SHADERPROGRAM
+* @param texture_id, texture stretched over every link
+*/
+void Rope::render(ShaderProgram* program, GLuint texture_id)
+{
+    RenderTimer timer(RENDER_ENTITY);
+
+    if (!m_is_active) return;
+
+    m_vertices.resize((ROPE_PARTICLE_COUNT - 1) * 16);
+    float* vertex = m_vertices.data();
+
+    for (int i = 0; i < ROPE_PARTICLE_COUNT - 1; i++)
+    {
+        float dx = m_x[i + 1] - m_x[i];
+        float dy = m_y[i + 1] - m_y[i];
+        float length = std::max(sqrtf(dx * dx + dy * dy), 1e-6f);
+
+        // half the link width, sideways to the link
+        float side_x = -dy / length * (ROPE_LINK_WIDTH / 2);
+        float side_y = dx / length * (ROPE_LINK_WIDTH / 2);
+
+        // top left, bottom left, bottom right, top right
+        vertex[0] = m_x[i] + side_x;      vertex[1] = m_y[i] + side_y;      vertex[2] = 0.0f;  vertex[3] = 0.0f;
+        vertex[4] = m_x[i] - side_x;      vertex[5] = m_y[i] - side_y;      vertex[6] = 0.0f;  vertex[7] = 1.0f;
+        vertex[8] = m_x[i + 1] - side_x;  vertex[9] = m_y[i + 1] - side_y;  vertex[10] = 1.0f; vertex[11] = 1.0f;
+        vertex[12] = m_x[i + 1] + side_x; vertex[13] = m_y[i + 1] + side_y; vertex[14] = 1.0f; vertex[15] = 0.0f;
+        vertex += 16;
+    }
+
+    // the links are already in world space
+    program->set_model_transform(Transform2D());
+
+    RenderBackend* backend = RenderBackend::get();
+    backend->set_layer(RENDER_LAYER_ENTITY, -1); // under the hook, which has the same program and texture
+    backend->bind_texture(GL_TEXTURE_2D, texture_id, 0);
+
+    backend->set_attribute(program->get_position_attribute(), 2, GL_FLOAT, false, 4 * sizeof(float), m_vertices.data());
+    backend->set_attribute(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 4 * sizeof(float), m_vertices.data() + 2);
+    backend->draw_quads(ROPE_PARTICLE_COUNT - 1);
+
+    backend->disable_attribute(program->get_position_attribute());
+    backend->disable_attribute(program->get_tex_coordinate_attribute());
+}
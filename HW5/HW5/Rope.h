@@ -0,0 +1,59 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+
+#define GL_GLEXT_PROTOTYPES 1
+#include <vector>
+#include <SDL_opengl.h>
+#include "glm/mat4x4.hpp"
+#include "ShaderProgram.h"
+#include "Entity.h"
+#include "Map.h"
+
+#define ROPE_PARTICLE_COUNT  16      // even, so every other constraint touches its own pair of particles
+#define ROPE_ITERATIONS      16      // per fixed step, the same on every machine so the swing is too
+#define ROPE_DAMPING         0.98f
+#define ROPE_GRAVITY         -9.81f
+#define ROPE_REEL_SPEED      2.0f    // how fast the player is pulled up while swinging
+#define ROPE_MIN_LENGTH      1.0f
+#define ROPE_LINK_WIDTH      0.12f
+
+/*
+* The grappling chain as a row of Verlet particles held together by distance constraints
+* The first particle is pinned to the hook and the last one to the player
+* While the hook is stuck the player swings from it on a rope that slowly reels in
+*
+* Particles are stored as a structure of arrays. Constraints are solved in two passes
+* (even links, then odd links) -- links in one pass share no particles, so each pass
+* solves four links at a time with SSE
+*/
+class Rope
+{
+private:
+    bool m_is_active = false;
+    float m_length = 0.0f; // length of the whole rope
+
+    std::vector<float> m_x, m_y;
+    std::vector<float> m_previous_x, m_previous_y;
+    std::vector<float> m_inverse_mass; // 0 for the pinned ends
+
+    std::vector<float> m_vertices;
+
+    void reset(glm::vec3 start, glm::vec3 end);
+    void integrate(float delta_time);
+    void solve_links(int first, float rest_length);
+    void collide(Map* map);
+
+public:
+    Rope();
+
+    void update(float delta_time, Entity* player, Entity* chain, Map* map);
+    void swing(Entity* player, glm::vec3 anchor);
+    void render(ShaderProgram* program, GLuint texture_id);
+
+    bool  const get_active_state()         const { return m_is_active; }
+    float const get_length()               const { return m_length; }
+};
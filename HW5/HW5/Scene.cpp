@@ -1 +1,23 @@
-#include "Scene.h"
\ No newline at end of file
+#include "Scene.h"
+#include <cstdlib>
+#include <iostream>
+
+#define LOG(argument) std::cout << argument << '\n'
+
+/*
+* Opens a scene's level file
+* Nothing in a scene can be built without its level, so the game quits
+* if neither the file nor the built-in copy can be used rather than
+* running on an empty map
+*
+* @param level, the level to open
+* @param filepath, path to the level file
+* @param fallback, a built-in copy of the level, or NULL
+*/
+void Scene::open_level(LevelFile& level, const char* filepath, const EmbeddedLevel* fallback)
+{
+    if (level.open(filepath, fallback)) return;
+
+    LOG("Can't go on without " << filepath << ", quitting.");
+    exit(1);
+}
@@ -19,15 +19,15 @@
 
 struct GameState
 {
-    Map* map;
-    Entity* player;
-    Entity* chain;
-    Entity* door;
-    Entity* enemies;
-
-    Mix_Music* bgm;
-    Mix_Chunk* jump_sfx;
-    Mix_Chunk* chain_sfx;
+    Map* map = NULL;
+    Entity* player = NULL;
+    Entity* chain = NULL;
+    Entity* door = NULL;
+    Entity* enemies = NULL;
+
+    Mix_Music* bgm = NULL;
+    Mix_Chunk* jump_sfx = NULL;
+    Mix_Chunk* chain_sfx = NULL;
 };
 
 class Scene {
@@ -40,6 +40,12 @@ public:
     virtual void update(float delta_time) = 0;
     virtual void render(ShaderProgram* program) = 0;
 
+    // the scene's level file, and the copy of it built into the game in case the file can't be used
+    virtual const char*   get_level_filepath() const = 0;
+    virtual EmbeddedLevel get_embedded_level() const = 0;
+
+    static void open_level(LevelFile& level, const char* filepath, const EmbeddedLevel* fallback = NULL);
+
     GameState const get_state()             const { return m_state; }
     int       const get_number_of_enemies() const { return m_number_of_enemies; }
 };
\ No newline at end of file
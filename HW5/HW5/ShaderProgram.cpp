@@ -1,35 +1,76 @@
 #define GL_SILENCE_DEPRECATION
 
 #include "ShaderProgram.h"
+#include "RenderBackend.h"
+#include "Utility.h"
+#include "AssetPack.h"
+#include <vector>
+#include <chrono>
+#include <cstring>
 
+bool   ShaderProgram::s_binary_cache_enabled = true;
+int    ShaderProgram::s_program_count = 0;
+int    ShaderProgram::s_binary_count = 0;
+double ShaderProgram::s_seconds_saved = 0.0;
+
+/*
+* Builds the program from its GLSL, or from the binary cache when the
+* driver and both sources are the same as when the cache was written
+*
+* @param vertex_shader_file, fragment_shader_file, paths to the GLSL
+*/
 void ShaderProgram::load(const char* vertex_shader_file, const char* fragment_shader_file) {
 
-    // create the vertex shader
-    m_vertex_shader = load_shader_from_file(vertex_shader_file, GL_VERTEX_SHADER);
-    // create the fragment shader
-    m_fragment_shader = load_shader_from_file(fragment_shader_file, GL_FRAGMENT_SHADER);
+    std::string vertex_source = read_file(vertex_shader_file);
+    std::string fragment_source = read_file(fragment_shader_file);
 
-    // Create the final shader program from our vertex and fragment shaders
-    m_program_id = glCreateProgram();
-    glAttachShader(m_program_id, m_vertex_shader);
-    glAttachShader(m_program_id, m_fragment_shader);
-    glLinkProgram(m_program_id);
+    // a binary only works on the driver that made it
+    std::string key_source = std::string((const char*)glGetString(GL_VENDOR)) + '\n' +
+        (const char*)glGetString(GL_RENDERER) + '\n' + (const char*)glGetString(GL_VERSION) + '\n' +
+        vertex_source + '\0' + fragment_source;
+    uint64_t key = Utility::hash((const unsigned char*)key_source.data(), key_source.size());
+    std::string cache_path = std::string(fragment_shader_file) + SHADER_CACHE_EXTENSION;
 
-    GLint link_success;
-    glGetProgramiv(m_program_id, GL_LINK_STATUS, &link_success);
+    s_program_count++;
+    m_vertex_shader = 0;
+    m_fragment_shader = 0;
 
-    if (link_success == GL_FALSE)
+    if (!load_binary(cache_path, key))
     {
-        printf("Error linking shader program!\n");
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        // create the vertex shader
+        m_vertex_shader = load_shader_from_string(vertex_source, GL_VERTEX_SHADER);
+        // create the fragment shader
+        m_fragment_shader = load_shader_from_string(fragment_source, GL_FRAGMENT_SHADER);
+
+        // Create the final shader program from our vertex and fragment shaders
+        m_program_id = glCreateProgram();
+        glAttachShader(m_program_id, m_vertex_shader);
+        glAttachShader(m_program_id, m_fragment_shader);
+        if (s_binary_cache_enabled && is_binary_cache_supported()) glProgramParameteri(m_program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(m_program_id);
+
+        GLint link_success;
+        glGetProgramiv(m_program_id, GL_LINK_STATUS, &link_success);
+
+        if (link_success == GL_FALSE)
+        {
+            printf("Error linking shader program!\n");
+        }
+        else save_binary(cache_path, key, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
     }
 
-    m_model_matrix_uniform = glGetUniformLocation(m_program_id, "modelMatrix");
+    m_model_linear_uniform = glGetUniformLocation(m_program_id, "modelLinear");
+    m_model_translation_uniform = glGetUniformLocation(m_program_id, "modelTranslation");
     m_projection_matrix_uniform = glGetUniformLocation(m_program_id, "projectionMatrix");
     m_view_matrix_uniform = glGetUniformLocation(m_program_id, "viewMatrix");
     m_colour_uniform = glGetUniformLocation(m_program_id, "color");
 
     m_position_attribute = glGetAttribLocation(m_program_id, "position");
     m_tex_coord_attribute = glGetAttribLocation(m_program_id, "texCoord");
+    m_layer_attribute = glGetAttribLocation(m_program_id, "layer");
+    m_animation_attribute = glGetAttribLocation(m_program_id, "animation");
 
     set_colour(1.0f, 1.0f, 1.0f, 1.0f);
 
@@ -42,21 +83,110 @@ void ShaderProgram::cleanup()
     glDeleteShader(m_fragment_shader);
 }
 
-GLuint ShaderProgram::load_shader_from_file(const std::string& shaderFile, GLenum type)
+std::string ShaderProgram::read_file(const std::string& filepath)
 {
+    // sources are a few hundred bytes and get hashed for the binary cache anyway, so copying is fine
+    const unsigned char* data;
+    size_t size;
+    if (AssetPack::get()->find(filepath, ASSET_SHADER, &data, &size)) return std::string((const char*)data, size);
+
     //Open a file stream with the file name
-    std::ifstream infile(shaderFile);
+    std::ifstream infile(filepath);
 
     if (infile.fail()) {
-        std::cout << "Error opening shader file:" << shaderFile << std::endl;
+        std::cout << "Error opening shader file:" << filepath << std::endl;
     }
 
     //Create a string buffer and stream the file to it
     std::stringstream buffer;
     buffer << infile.rdbuf();
 
-    // Load the shader from the contents of the file
-    return load_shader_from_string(buffer.str(), type);
+    return buffer.str();
+}
+
+// drivers without program binaries report no formats
+bool ShaderProgram::is_binary_cache_supported()
+{
+    GLint format_count = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+    return format_count > 0;
+}
+
+/*
+* Links the program from its cached binary
+* Fails on a missing or stale cache, and when the driver turns the binary down
+*
+* @param cache_path, path to the cache file
+* @param key, what the cache has to have been made from
+* @return true if the program is ready
+*/
+bool ShaderProgram::load_binary(const std::string& cache_path, uint64_t key)
+{
+    if (!s_binary_cache_enabled || !is_binary_cache_supported()) return false;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::ifstream file(cache_path, std::ios::binary);
+    if (file.fail()) return false;
+
+    ShaderCacheHeader header;
+    if (!file.read((char*)&header, sizeof(header))) return false;
+    if (memcmp(header.magic, "HWSP", 4) != 0 || header.version != SHADER_CACHE_VERSION || header.key != key) return false;
+
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), header.length)) return false;
+
+    GLuint program_id = glCreateProgram();
+    glProgramBinary(program_id, header.format, binary.data(), (GLsizei)header.length);
+
+    // e.g. after a driver update that kept the version string
+    GLint link_success;
+    glGetProgramiv(program_id, GL_LINK_STATUS, &link_success);
+    if (link_success == GL_FALSE)
+    {
+        glDeleteProgram(program_id);
+        return false;
+    }
+
+    m_program_id = program_id;
+    s_binary_count++;
+    s_seconds_saved += header.compile_seconds - std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return true;
+}
+
+/*
+* Writes the linked program's binary for the next run
+* Failing is fine -- the program is just built from source again
+*
+* @param cache_path, path to the cache file
+* @param key, what the program was made from
+* @param compile_seconds, how long building it from source took
+*/
+void ShaderProgram::save_binary(const std::string& cache_path, uint64_t key, double compile_seconds)
+{
+    if (!s_binary_cache_enabled || !is_binary_cache_supported()) return;
+
+    GLint length = 0;
+    glGetProgramiv(m_program_id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<char> binary(length);
+    GLenum format;
+    glGetProgramBinary(m_program_id, length, &length, &format, binary.data());
+
+    ShaderCacheHeader header;
+    memcpy(header.magic, "HWSP", 4);
+    header.version = SHADER_CACHE_VERSION;
+    header.key = key;
+    header.format = format;
+    header.length = (uint32_t)length;
+    header.compile_seconds = compile_seconds;
+
+    std::ofstream file(cache_path, std::ios::binary);
+    if (file.fail()) return;
+    file.write((const char*)&header, sizeof(header));
+    file.write(binary.data(), length);
 }
 
 GLuint ShaderProgram::load_shader_from_string(const std::string& shaderContents, GLenum type)
@@ -90,24 +220,56 @@ GLuint ShaderProgram::load_shader_from_string(const std::string& shaderContents,
 
 void ShaderProgram::set_colour(float red, float green, float blue, float alpha)
 {
-    glUseProgram(m_program_id);
-    glUniform4f(m_colour_uniform, red, green, blue, alpha);
+    RenderBackend::get()->use_program(m_program_id);
+    RenderBackend::get()->set_uniform_vec4(m_colour_uniform, red, green, blue, alpha);
 }
 
 void ShaderProgram::set_view_matrix(const glm::mat4& matrix)
 {
-    glUseProgram(m_program_id);
-    glUniformMatrix4fv(m_view_matrix_uniform, 1, GL_FALSE, &matrix[0][0]);
+    m_view_matrix = matrix;
+    RenderBackend::get()->use_program(m_program_id);
+    RenderBackend::get()->set_uniform_matrix(m_view_matrix_uniform, matrix);
+}
+
+// the model transform is 2D -- 6 floats instead of a mat4
+void ShaderProgram::set_model_transform(const Transform2D& transform)
+{
+    glm::vec4 linear = transform.get_linear();
+    RenderBackend::get()->use_program(m_program_id);
+    RenderBackend::get()->set_uniform_vec4(m_model_linear_uniform, linear.x, linear.y, linear.z, linear.w);
+    RenderBackend::get()->set_uniform_vec2(m_model_translation_uniform, transform.position.x, transform.position.y);
 }
 
+// only the x/y part of the matrix is used, which is exact for anything built in 2D
 void ShaderProgram::set_model_matrix(const glm::mat4& matrix)
 {
-    glUseProgram(m_program_id);
-    glUniformMatrix4fv(m_model_matrix_uniform, 1, GL_FALSE, &matrix[0][0]);
+    RenderBackend::get()->use_program(m_program_id);
+    RenderBackend::get()->set_uniform_vec4(m_model_linear_uniform, matrix[0][0], matrix[0][1], matrix[1][0], matrix[1][1]);
+    RenderBackend::get()->set_uniform_vec2(m_model_translation_uniform, matrix[3][0], matrix[3][1]);
 }
 
 void ShaderProgram::set_projection_matrix(const glm::mat4& matrix)
 {
-    glUseProgram(m_program_id);
-    glUniformMatrix4fv(m_projection_matrix_uniform, 1, GL_FALSE, &matrix[0][0]);
+    m_projection_matrix = matrix;
+    RenderBackend::get()->use_program(m_program_id);
+    RenderBackend::get()->set_uniform_matrix(m_projection_matrix_uniform, matrix);
+}
+
+// uniforms only some shaders have, looked up by name
+void ShaderProgram::set_uniform_int(const char* name, int value)
+{
+    RenderBackend::get()->use_program(m_program_id);
+    RenderBackend::get()->set_uniform_int(RenderBackend::get()->get_uniform_location(m_program_id, name), value);
+}
+
+void ShaderProgram::set_uniform_vec2(const char* name, float x, float y)
+{
+    RenderBackend::get()->use_program(m_program_id);
+    RenderBackend::get()->set_uniform_vec2(RenderBackend::get()->get_uniform_location(m_program_id, name), x, y);
+}
+
+void ShaderProgram::set_uniform_float(const char* name, float value)
+{
+    RenderBackend::get()->use_program(m_program_id);
+    RenderBackend::get()->set_uniform_float(RenderBackend::get()->get_uniform_location(m_program_id, name), value);
 }
\ No newline at end of file
@@ -9,7 +9,23 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <cstdint>
 #include "glm/mat4x4.hpp"
+#include "Transform2D.h"
+
+#define SHADER_CACHE_EXTENSION ".program" // shaders/fragment_textured.glsl.program
+#define SHADER_CACHE_VERSION   1
+
+// start of every program binary cache file, followed by the binary
+struct ShaderCacheHeader
+{
+    char     magic[4]; // "HWSP"
+    uint32_t version;
+    uint64_t key;             // hash of the driver and both shader sources
+    uint32_t format;          // from glGetProgramBinary
+    uint32_t length;
+    double   compile_seconds; // what building it from source took, to report what the cache saves
+};
 
 class ShaderProgram
 {
@@ -17,33 +33,64 @@ private:
     void cleanup();
 
     GLuint load_shader_from_string(const std::string& shader_contents, GLenum shader_type);
-    GLuint load_shader_from_file(const std::string& shader_file, GLenum shader_type);
+    static std::string read_file(const std::string& filepath);
+
+    // compiled programs are kept next to their fragment shader and reloaded with glProgramBinary
+    static bool   s_binary_cache_enabled;
+    static int    s_program_count;
+    static int    s_binary_count;  // programs that came from the cache
+    static double s_seconds_saved;
+
+    static bool is_binary_cache_supported();
+    bool load_binary(const std::string& cache_path, uint64_t key);
+    void save_binary(const std::string& cache_path, uint64_t key, double compile_seconds);
 
     GLuint m_program_id;
 
     GLuint m_projection_matrix_uniform;
-    GLuint m_model_matrix_uniform;
+    GLuint m_model_linear_uniform;
+    GLuint m_model_translation_uniform;
     GLuint m_view_matrix_uniform;
     GLuint m_colour_uniform;
 
     GLuint m_position_attribute;
     GLuint m_tex_coord_attribute;
+    GLuint m_layer_attribute;     // texture array layer, only in the tile array shaders
+    GLuint m_animation_attribute; // tile animation, only in the tile array shaders
 
     GLuint m_vertex_shader;
     GLuint m_fragment_shader;
 
+    // last matrices set, so the camera can be undone (see RenderCache)
+    glm::mat4 m_projection_matrix = glm::mat4(1.0f);
+    glm::mat4 m_view_matrix = glm::mat4(1.0f);
+
 public:
 
     void load(const char* vertex_shader_file, const char* fragment_shader_file);
 
+    void set_model_transform(const Transform2D& transform);
     void set_model_matrix(const glm::mat4& matrix);
     void set_projection_matrix(const glm::mat4& matrix);
     void set_view_matrix(const glm::mat4& matrix);
     void set_colour(float red, float green, float blue, float alpha);
+    void set_uniform_int(const char* name, int value);
+    void set_uniform_vec2(const char* name, float x, float y);
+    void set_uniform_float(const char* name, float value);
 
     GLuint const get_program_id()               const { return m_program_id; };
     GLuint const get_position_attribute()       const { return m_position_attribute; };
     GLuint const get_tex_coordinate_attribute() const { return m_tex_coord_attribute; };
+    GLuint const get_layer_attribute()          const { return m_layer_attribute; };
+    GLuint const get_animation_attribute()      const { return m_animation_attribute; };
+
+    glm::mat4 const get_projection_matrix() const { return m_projection_matrix; };
+    glm::mat4 const get_view_matrix()       const { return m_view_matrix; };
 
     void set_program_id(GLuint program_id) { m_program_id = program_id; };
+
+    static void   set_binary_cache_enabled(bool is_enabled) { s_binary_cache_enabled = is_enabled; };
+    static int    get_program_count() { return s_program_count; };
+    static int    get_binary_count()  { return s_binary_count; };
+    static double get_seconds_saved() { return s_seconds_saved; };
 };
\ No newline at end of file
@@ -0,0 +1,233 @@
+#include "SparseTileLayer.h"
+#include <algorithm>
+
+#define SPARSE_EMPTY_KEY UINT32_MAX
+
+/*
+* Makes an empty layer -- every tile reads as 0 until it is set
+*
+* @param index_size, bytes per tile id, 1, 2 or 4 -- anything else gets 4
+* @param width, height, layer size in tiles, up to 65535 chunks each way
+*/
+std::unique_ptr<SparseTileLayer> SparseTileLayer::create(int index_size, int width, int height)
+{
+    switch (index_size)
+    {
+    case 1:  return std::unique_ptr<SparseTileLayer>(new SparseTileArray<uint8_t>(width, height));
+    case 2:  return std::unique_ptr<SparseTileLayer>(new SparseTileArray<uint16_t>(width, height));
+    default: return std::unique_ptr<SparseTileLayer>(new SparseTileArray<uint32_t>(width, height));
+    }
+}
+
+/*
+* @return the fewest bytes, 1, 2 or 4, that hold the tile id
+*/
+int SparseTileLayer::get_index_size(unsigned int tile)
+{
+    if (tile <= UINT8_MAX) return 1;
+    if (tile <= UINT16_MAX) return 2;
+    return 4;
+}
+
+/*
+* @return the index of the chunk, or SPARSE_EMPTY_KEY if it's all empty
+*/
+uint32_t SparseTileLayer::find_chunk(uint32_t key) const
+{
+    if (m_slots.empty()) return SPARSE_EMPTY_KEY;
+
+    uint32_t mask = (uint32_t)m_slots.size() - 1;
+    uint32_t hash = key * 2654435769u; // Fibonacci hashing, so neighbouring chunks spread out
+    for (uint32_t i = (hash ^ hash >> 16) & mask; ; i = (i + 1) & mask)
+    {
+        if (m_slots[i].key == key) return m_slots[i].chunk;
+        if (m_slots[i].key == SPARSE_EMPTY_KEY) return SPARSE_EMPTY_KEY;
+    }
+}
+
+/*
+* The chunk holding a tile, only looked up when it isn't the last one looked up
+* Main thread only, since the last chunk is shared
+*
+* @return the index of the chunk, or SPARSE_EMPTY_KEY if it's all empty
+*/
+uint32_t SparseTileLayer::find_cached_chunk(int x, int y) const
+{
+    uint32_t key = get_key(x / SPARSE_CHUNK_SIZE, y / SPARSE_CHUNK_SIZE);
+    if (key != m_last_key)
+    {
+        m_last_key = key;
+        m_last_chunk = find_chunk(key);
+    }
+
+    return m_last_chunk;
+}
+
+// doubles the table and puts every chunk back in
+void SparseTileLayer::grow()
+{
+    std::vector<SparseTileSlot> slots = std::move(m_slots);
+    m_slots.assign(std::max<size_t>(slots.size() * 2, 16), { SPARSE_EMPTY_KEY, 0 });
+
+    uint32_t mask = (uint32_t)m_slots.size() - 1;
+    for (const SparseTileSlot& slot : slots)
+    {
+        if (slot.key == SPARSE_EMPTY_KEY) continue;
+
+        uint32_t hash = slot.key * 2654435769u;
+        uint32_t i = (hash ^ hash >> 16) & mask;
+        while (m_slots[i].key != SPARSE_EMPTY_KEY) i = (i + 1) & mask;
+        m_slots[i] = slot;
+    }
+}
+
+/*
+* Makes an empty chunk, which must not be in the table yet
+*
+* @return the new chunk's index
+*/
+uint32_t SparseTileLayer::add_chunk(uint32_t key)
+{
+    if ((size_t)(m_chunk_count + 1) * 2 > m_slots.size()) grow();
+
+    uint32_t chunk = (uint32_t)m_chunk_count++;
+    m_solid_rows.resize(m_solid_rows.size() + SPARSE_CHUNK_SIZE, 0);
+    add_chunk_tiles();
+
+    uint32_t mask = (uint32_t)m_slots.size() - 1;
+    uint32_t hash = key * 2654435769u;
+    uint32_t i = (hash ^ hash >> 16) & mask;
+    while (m_slots[i].key != SPARSE_EMPTY_KEY) i = (i + 1) & mask;
+    m_slots[i] = { key, chunk };
+
+    // the last lookup may have been this chunk while it was still empty
+    m_last_key = SPARSE_EMPTY_KEY;
+    return chunk;
+}
+
+void SparseTileLayer::set_solid(uint32_t chunk, int x, int y, bool is_solid)
+{
+    uint16_t& row = m_solid_rows[chunk * SPARSE_CHUNK_SIZE + y % SPARSE_CHUNK_SIZE];
+    uint16_t bit = (uint16_t)(1u << (x % SPARSE_CHUNK_SIZE));
+    row = is_solid ? (uint16_t)(row | bit) : (uint16_t)(row & ~bit);
+}
+
+/*
+* Whether a tile is non-empty, without reading its id
+* Main thread only, since the last chunk is shared
+*
+* @param x, y, tile position, which has to be inside the layer
+*/
+bool SparseTileLayer::is_solid(int x, int y) const
+{
+    uint32_t chunk = find_cached_chunk(x, y);
+    if (chunk == SPARSE_EMPTY_KEY) return false;
+    return (m_solid_rows[chunk * SPARSE_CHUNK_SIZE + y % SPARSE_CHUNK_SIZE] >> (x % SPARSE_CHUNK_SIZE)) & 1;
+}
+
+/*
+* Copies a whole row in -- only the chunks with a non-empty tile are made
+* Ids too big for T are cut down, so the layer has to be made wide enough
+*
+* @param y, the row
+* @param tiles, width tile ids
+*/
+template <typename T>
+void SparseTileArray<T>::set_row(int y, const unsigned int* tiles)
+{
+    int chunk_y = y / SPARSE_CHUNK_SIZE;
+    int row_start = (y % SPARSE_CHUNK_SIZE) * SPARSE_CHUNK_SIZE;
+
+    for (int first_x = 0; first_x < m_width; first_x += SPARSE_CHUNK_SIZE)
+    {
+        int count = std::min(SPARSE_CHUNK_SIZE, m_width - first_x);
+        uint32_t key = get_key(first_x / SPARSE_CHUNK_SIZE, chunk_y);
+
+        uint32_t chunk = find_chunk(key);
+        if (chunk == SPARSE_EMPTY_KEY)
+        {
+            if (std::all_of(tiles + first_x, tiles + first_x + count, [](unsigned int tile) { return tile == 0; })) continue;
+            chunk = add_chunk(key);
+        }
+
+        T* chunk_row = &m_tiles[(size_t)chunk * SPARSE_CHUNK_SIZE * SPARSE_CHUNK_SIZE + row_start];
+        uint16_t solid = 0;
+        for (int x = 0; x < count; x++)
+        {
+            chunk_row[x] = (T)tiles[first_x + x];
+            solid |= (uint16_t)((tiles[first_x + x] != 0) << x);
+        }
+        m_solid_rows[chunk * SPARSE_CHUNK_SIZE + y % SPARSE_CHUNK_SIZE] = solid;
+    }
+}
+
+/*
+* Sets one tile, making its chunk if it needs one
+*
+* @param x, y, tile position, which has to be inside the layer
+* @param tile, the new tile id, which has to fit in T
+*/
+template <typename T>
+void SparseTileArray<T>::set_tile(int x, int y, unsigned int tile)
+{
+    uint32_t key = get_key(x / SPARSE_CHUNK_SIZE, y / SPARSE_CHUNK_SIZE);
+    uint32_t chunk = find_chunk(key);
+    if (chunk == SPARSE_EMPTY_KEY)
+    {
+        if (tile == 0) return;
+        chunk = add_chunk(key);
+    }
+
+    m_tiles[(size_t)chunk * SPARSE_CHUNK_SIZE * SPARSE_CHUNK_SIZE + (y % SPARSE_CHUNK_SIZE) * SPARSE_CHUNK_SIZE + x % SPARSE_CHUNK_SIZE] = (T)tile;
+    set_solid(chunk, x, y, tile != 0);
+}
+
+/*
+* Copies part of one row out -- doesn't touch the last chunk cache, so it is safe
+* from any thread as long as nothing is being set
+*
+* @param y, the row
+* @param first_x, count, which tiles of the row
+* @param tiles, count tile ids out
+*/
+template <typename T>
+void SparseTileArray<T>::read_row(int y, int first_x, int count, unsigned int* tiles) const
+{
+    int chunk_y = y / SPARSE_CHUNK_SIZE;
+    int row_start = (y % SPARSE_CHUNK_SIZE) * SPARSE_CHUNK_SIZE;
+
+    int last_x = first_x + count;
+    for (int x = first_x; x < last_x; )
+    {
+        int chunk_x = x / SPARSE_CHUNK_SIZE;
+        int span_end = std::min((chunk_x + 1) * SPARSE_CHUNK_SIZE, last_x);
+
+        uint32_t chunk = find_chunk(get_key(chunk_x, chunk_y));
+        if (chunk == SPARSE_EMPTY_KEY) std::fill(tiles + (x - first_x), tiles + (span_end - first_x), 0u);
+        else
+        {
+            const T* chunk_row = &m_tiles[(size_t)chunk * SPARSE_CHUNK_SIZE * SPARSE_CHUNK_SIZE + row_start];
+            std::copy(chunk_row + x % SPARSE_CHUNK_SIZE, chunk_row + (span_end - 1) % SPARSE_CHUNK_SIZE + 1, tiles + (x - first_x));
+        }
+
+        x = span_end;
+    }
+}
+
+/*
+* One tile, through the last chunk cache
+* Main thread only, since the last chunk is shared
+*
+* @param x, y, tile position, which has to be inside the layer
+*/
+template <typename T>
+unsigned int SparseTileArray<T>::get_tile(int x, int y) const
+{
+    uint32_t chunk = find_cached_chunk(x, y);
+    if (chunk == SPARSE_EMPTY_KEY) return 0;
+    return m_tiles[(size_t)chunk * SPARSE_CHUNK_SIZE * SPARSE_CHUNK_SIZE + (y % SPARSE_CHUNK_SIZE) * SPARSE_CHUNK_SIZE + x % SPARSE_CHUNK_SIZE];
+}
+
+template class SparseTileArray<uint8_t>;
+template class SparseTileArray<uint16_t>;
+template class SparseTileArray<uint32_t>;
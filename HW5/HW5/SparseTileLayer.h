@@ -0,0 +1,102 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+#define SPARSE_CHUNK_SIZE 16 // chunks are SPARSE_CHUNK_SIZE x SPARSE_CHUNK_SIZE tiles
+
+// a slot of the chunk table -- key is chunk_y << 16 | chunk_x
+struct SparseTileSlot
+{
+    uint32_t key;
+    uint32_t chunk; // index into the chunks
+};
+
+/*
+* A tile layer that only stores the chunks with something in them
+*
+* Chunks are found through an open addressing hash table keyed by their
+* coordinate, and every chunk that isn't there is all empty. Lookups
+* remember the last chunk they found, since they come in bunches around
+* the player, the lights and whatever is being edited.
+* Chunks stay allocated once made, even if their tiles are emptied again.
+* Adding a chunk can move the others, so reads from other threads have to be
+* kept apart from set_row() and set_tile().
+*
+* Tile ids are stored as 1, 2 or 4 byte integers (see SparseTileArray), picked
+* once when the layer is made. Each chunk also keeps a bit per tile for
+* is_solid(), which never needs to know how wide the ids are.
+*/
+class SparseTileLayer
+{
+protected:
+    int m_width = 0;
+    int m_height = 0;
+    int m_chunk_count = 0;
+
+    std::vector<uint16_t>       m_solid_rows; // SPARSE_CHUNK_SIZE per chunk, bit x set for solid tiles
+    std::vector<SparseTileSlot> m_slots;      // a power of two of them, at most half full
+
+    // main thread only -- see is_solid()
+    mutable uint32_t m_last_key = UINT32_MAX;
+    mutable uint32_t m_last_chunk = UINT32_MAX; // UINT32_MAX when the last chunk looked up is empty
+
+    static uint32_t const get_key(int chunk_x, int chunk_y) { return (uint32_t)chunk_y << 16 | (uint32_t)chunk_x; }
+
+    uint32_t find_chunk(uint32_t key) const;
+    uint32_t find_cached_chunk(int x, int y) const;
+    uint32_t add_chunk(uint32_t key);
+    void     grow();
+    void     set_solid(uint32_t chunk, int x, int y, bool is_solid);
+
+    // makes room for one more chunk of all empty tiles
+    virtual void add_chunk_tiles() = 0;
+
+public:
+    virtual ~SparseTileLayer() {}
+
+    static std::unique_ptr<SparseTileLayer> create(int index_size, int width, int height);
+    static int get_index_size(unsigned int tile);
+
+    virtual void set_row(int y, const unsigned int* tiles) = 0;
+    virtual void set_tile(int x, int y, unsigned int tile) = 0;
+
+    virtual void         read_row(int y, int first_x, int count, unsigned int* tiles) const = 0;
+    virtual unsigned int get_tile(int x, int y) const = 0;
+
+    bool is_solid(int x, int y) const;
+
+    virtual int const get_index_size() const = 0;
+    int    const get_chunk_count() const { return m_chunk_count; }
+    size_t const get_byte_count()  const
+    {
+        return m_chunk_count * (SPARSE_CHUNK_SIZE * SPARSE_CHUNK_SIZE * (size_t)get_index_size() + SPARSE_CHUNK_SIZE * sizeof(uint16_t)) +
+            m_slots.size() * sizeof(SparseTileSlot);
+    }
+};
+
+/*
+* The tiles of a SparseTileLayer, as T, a chunk at a time
+* Every loop over tiles is compiled once per id width, so none of them
+* check the width as they go
+*/
+template <typename T>
+class SparseTileArray final : public SparseTileLayer
+{
+private:
+    std::vector<T> m_tiles; // SPARSE_CHUNK_SIZE * SPARSE_CHUNK_SIZE per chunk, row by row
+
+    void add_chunk_tiles() override { m_tiles.resize(m_tiles.size() + SPARSE_CHUNK_SIZE * SPARSE_CHUNK_SIZE, 0); }
+
+public:
+    SparseTileArray(int width, int height) { m_width = width; m_height = height; }
+
+    void set_row(int y, const unsigned int* tiles) override;
+    void set_tile(int x, int y, unsigned int tile) override;
+
+    void         read_row(int y, int first_x, int count, unsigned int* tiles) const override;
+    unsigned int get_tile(int x, int y) const override;
+
+    int const get_index_size() const override { return (int)sizeof(T); }
+};
@@ -0,0 +1,142 @@
+#include "TextureCache.h"
+#include "Utility.h"
+#include "stb_image.h"
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <functional>
+#include <sys/stat.h>
+
+bool TextureCache::s_enabled = true;
+
+bool TextureCache::read_file(const std::string& filepath, std::vector<unsigned char>& bytes)
+{
+    FILE* file = fopen(filepath.c_str(), "rb");
+    if (file == NULL) return false;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    bytes.resize(size > 0 ? (size_t)size : 0);
+    bool is_read = size > 0 && fread(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    fclose(file);
+
+    return is_read;
+}
+
+/*
+* Writes a cache file through a temporary file, so a half written cache is never read
+* Failing is fine (e.g. a read-only install) -- the PNG is just decoded again next time
+*
+* @param cache_path, where the cache goes
+* @param image, the decoded pixels
+* @param header, filled in apart from the magic and version
+*/
+void TextureCache::write(const std::string& cache_path, const DecodedImage& image, const TextureCacheHeader& header)
+{
+    // two workers can be decoding the same PNG (a tile set as a texture and as an array)
+    std::string temporary_path = cache_path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+    FILE* file = fopen(temporary_path.c_str(), "wb");
+    if (file == NULL) return;
+
+    bool is_written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(image.get_pixels(), 1, image.get_byte_count(), file) == (size_t)image.get_byte_count();
+    fclose(file);
+
+    // rename won't replace an existing file everywhere
+    if (is_written) remove(cache_path.c_str());
+    if (!is_written || rename(temporary_path.c_str(), cache_path.c_str()) != 0) remove(temporary_path.c_str());
+}
+
+/*
+* Decodes a PNG (or anything else stb_image reads) with no cache involved
+*
+* @param filepath, path to the image
+*/
+DecodedImage TextureCache::decode_png(const std::string& filepath)
+{
+    DecodedImage image;
+
+    int number_of_components;
+    unsigned char* pixels = stbi_load(filepath.c_str(), &image.width, &image.height, &number_of_components, STBI_rgb_alpha);
+    if (pixels == NULL) return DecodedImage();
+
+    image.pixels.assign(pixels, pixels + image.get_byte_count());
+    stbi_image_free(pixels);
+
+    return image;
+}
+
+/*
+* Loads an image through its cache file, making the cache if it is missing or stale
+* Safe to call from any thread
+*
+* @param filepath, path to the PNG
+*/
+DecodedImage TextureCache::load(const std::string& filepath)
+{
+    if (!s_enabled) return decode_png(filepath);
+
+    struct stat source;
+    if (stat(filepath.c_str(), &source) != 0) return DecodedImage();
+
+    std::string cache_path = filepath + TEXTURE_CACHE_EXTENSION;
+    std::vector<unsigned char> bytes;
+    bool has_bytes = false;
+
+    {
+        std::shared_ptr<MappedFile> cache = std::make_shared<MappedFile>();
+        if (cache->open(cache_path) && cache->get_size() >= sizeof(TextureCacheHeader))
+        {
+            TextureCacheHeader header;
+            memcpy(&header, cache->get_data(), sizeof(header));
+
+            bool is_valid = memcmp(header.magic, "HWTX", 4) == 0 && header.version == TEXTURE_CACHE_VERSION &&
+                cache->get_size() == sizeof(header) + (size_t)header.width * header.height * 4;
+            bool is_current = is_valid && header.source_size == (uint64_t)source.st_size &&
+                header.source_mtime == (int64_t)source.st_mtime;
+
+            // same size but touched -- the contents decide
+            if (is_valid && !is_current && header.source_size == (uint64_t)source.st_size)
+            {
+                has_bytes = read_file(filepath, bytes);
+                is_current = has_bytes && Utility::hash(bytes.data(), bytes.size()) == header.source_hash;
+            }
+
+            if (is_current)
+            {
+                DecodedImage image;
+                image.width = (int)header.width;
+                image.height = (int)header.height;
+                image.mapping = cache;
+                image.mapping_offset = sizeof(header);
+                return image;
+            }
+        }
+        // the mapping has to be gone before the cache is replaced
+    }
+
+    if (!has_bytes && !read_file(filepath, bytes)) return DecodedImage();
+
+    DecodedImage image;
+    int number_of_components;
+    unsigned char* pixels = stbi_load_from_memory(bytes.data(), (int)bytes.size(), &image.width, &image.height, &number_of_components, STBI_rgb_alpha);
+    if (pixels == NULL) return DecodedImage();
+
+    image.pixels.assign(pixels, pixels + image.get_byte_count());
+    stbi_image_free(pixels);
+
+    TextureCacheHeader header;
+    memcpy(header.magic, "HWTX", 4);
+    header.version = TEXTURE_CACHE_VERSION;
+    header.width = (uint32_t)image.width;
+    header.height = (uint32_t)image.height;
+    header.source_size = (uint64_t)source.st_size;
+    header.source_mtime = (int64_t)source.st_mtime;
+    header.source_hash = Utility::hash(bytes.data(), bytes.size());
+    write(cache_path, image, header);
+
+    return image;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include "MappedFile.h"
+
+#define TEXTURE_CACHE_EXTENSION ".rgba"   // the cache for Player.png is Player.png.rgba
+#define TEXTURE_CACHE_VERSION   1
+
+// an image decoded to RGBA, width 0 if the file couldn't be read
+struct DecodedImage
+{
+    int width = 0;
+    int height = 0;
+
+    // decoded into memory of our own...
+    std::vector<unsigned char> pixels;
+
+    // ...or read straight out of a mapped texture cache file
+    std::shared_ptr<MappedFile> mapping;
+    size_t mapping_offset = 0;
+
+    const unsigned char* get_pixels() const { return mapping ? mapping->get_data() + mapping_offset : pixels.data(); }
+    int const get_byte_count() const { return width * height * 4; }
+};
+
+// start of every cache file, followed by width * height RGBA pixels
+struct TextureCacheHeader
+{
+    char     magic[4]; // "HWTX"
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint64_t source_size;  // of the PNG the pixels came from
+    int64_t  source_mtime;
+    uint64_t source_hash;  // FNV-1a of the PNG's bytes
+};
+
+/*
+* Decoded textures kept on disk as raw RGBA next to their PNGs, so
+* later runs skip the PNG inflate and map the pixels straight in
+*
+* A cache file is used when the PNG's size and modification time match
+* its header. If only the time differs (a fresh checkout, a touch) the
+* PNG is hashed and the cache is still used when the contents match.
+* Anything else decodes the PNG and rewrites the cache.
+*
+* Files are uncompressed -- every texture here is small, and mapping
+* them lets the pixels go to glTexImage2D without a copy.
+*/
+class TextureCache
+{
+private:
+    static bool s_enabled;
+
+    static bool read_file(const std::string& filepath, std::vector<unsigned char>& bytes);
+    static void write(const std::string& cache_path, const DecodedImage& image, const TextureCacheHeader& header);
+
+public:
+    static DecodedImage load(const std::string& filepath);
+    static DecodedImage decode_png(const std::string& filepath);
+
+    static void set_enabled(bool is_enabled) { s_enabled = is_enabled; }
+    static bool get_enabled() { return s_enabled; }
+};
@@ -0,0 +1,225 @@
+#include "TextureLoader.h"
+#include "Utility.h"
+#include "AssetPack.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#define LOG(argument) std::cout << argument << '\n'
+
+TextureLoader g_texture_loader;
+TextureLoader* TextureLoader::s_loader = &g_texture_loader;
+
+/*
+* @param upload_budget, bytes of pixels upload_pending() may send to GL per call
+*/
+TextureLoader::TextureLoader(int upload_budget)
+{
+    m_upload_budget = upload_budget;
+}
+
+TextureLoader::~TextureLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_job_mutex);
+        m_workers_running = false;
+    }
+    m_job_condition.notify_all();
+
+    for (std::thread& worker : m_workers) worker.join();
+}
+
+/*
+* Workers start with the first decode, so a loader that is never used
+* (or one built before main) costs no threads
+*/
+void TextureLoader::start_workers()
+{
+    if (m_workers_running) return;
+    m_workers_running = true;
+
+    // leave a core for the main thread
+    int thread_count = (int)std::thread::hardware_concurrency() - 1;
+    thread_count = std::min(std::max(thread_count, 1), TEXTURE_MAX_DECODE_THREADS);
+    for (int i = 0; i < thread_count; i++) m_workers.push_back(std::thread(&TextureLoader::worker, this));
+}
+
+void TextureLoader::worker()
+{
+    while (true)
+    {
+        std::packaged_task<DecodedImage()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_job_mutex);
+            m_job_condition.wait(lock, [this] { return !m_jobs.empty() || !m_workers_running; });
+            if (!m_workers_running) return;
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        job();
+    }
+}
+
+/*
+* Reads an image as RGBA, straight out of the asset pack if it has it,
+* otherwise through the TextureCache -- safe to call from any thread
+*
+* @param filepath, path to the image
+*/
+DecodedImage TextureLoader::decode_file(const std::string& filepath)
+{
+    AssetPack* pack = AssetPack::get();
+
+    const unsigned char* data;
+    size_t size;
+    if (pack->find(filepath, ASSET_IMAGE, &data, &size) && size >= sizeof(AssetImageHeader))
+    {
+        AssetImageHeader header;
+        memcpy(&header, data, sizeof(header));
+
+        if (size == sizeof(header) + (size_t)header.width * header.height * 4)
+        {
+            DecodedImage image;
+            image.width = (int)header.width;
+            image.height = (int)header.height;
+            image.mapping = pack->get_file();
+            image.mapping_offset = (size_t)(data - image.mapping->get_data()) + sizeof(header);
+            return image;
+        }
+    }
+
+    return TextureCache::load(filepath);
+}
+
+/*
+* Queues an image to be decoded on a worker thread
+*
+* @param filepath, path to the image
+* @return the decoded image, once a worker gets to it
+*/
+std::shared_future<DecodedImage> TextureLoader::decode(const char* filepath)
+{
+    std::string path = filepath;
+    std::packaged_task<DecodedImage()> job([path] { return decode_file(path); });
+    std::shared_future<DecodedImage> image = job.get_future().share();
+
+    {
+        std::lock_guard<std::mutex> lock(m_job_mutex);
+        start_workers();
+        m_jobs.push_back(std::move(job));
+    }
+    m_job_condition.notify_one();
+
+    return image;
+}
+
+/*
+* Hands out the texture for an image, queueing the decode the first time it is asked for
+* Until it is uploaded the texture is one transparent pixel (one layer for arrays)
+*
+* @param filepath, path to the image
+* @param tile_count_x, tile_count_y, tiles across and down for an array texture, 0 for a plain one
+*/
+GLuint TextureLoader::request(const char* filepath, int tile_count_x, int tile_count_y)
+{
+    std::string key = filepath;
+    if (tile_count_x > 0) key += "#" + std::to_string(tile_count_x) + "x" + std::to_string(tile_count_y);
+
+    std::map<std::string, GLuint>::iterator found = m_textures.find(key);
+    if (found != m_textures.end()) return found->second;
+
+    static const unsigned char transparent[4] = { 0, 0, 0, 0 };
+
+    GLuint texture_id;
+    glGenTextures(1, &texture_id);
+    if (tile_count_x > 0)
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture_id);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, 1, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, transparent);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    else
+    {
+        glBindTexture(GL_TEXTURE_2D, texture_id);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, transparent);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+
+    m_textures[key] = texture_id;
+    m_pending.push_back({ texture_id, tile_count_x, tile_count_y, decode(filepath) });
+
+    return texture_id;
+}
+
+GLuint TextureLoader::load_texture(const char* filepath)
+{
+    return request(filepath, 0, 0);
+}
+
+GLuint TextureLoader::load_texture_array(const char* filepath, int tile_count_x, int tile_count_y)
+{
+    return request(filepath, tile_count_x, tile_count_y);
+}
+
+void TextureLoader::upload(const PendingTexture& texture)
+{
+    const DecodedImage& image = texture.image.get();
+    if (image.width == 0)
+    {
+        LOG("Unable to load image. Make sure the path is correct.");
+        assert(false);
+        return;
+    }
+
+    if (texture.tile_count_x > 0)
+    {
+        Utility::upload_texture_array(texture.texture_id, image.width, image.height, image.get_pixels(),
+            texture.tile_count_x, texture.tile_count_y);
+    }
+    else Utility::upload_texture(texture.texture_id, image.width, image.height, image.get_pixels());
+    m_upload_generation++;
+}
+
+/*
+* Sends decoded images to GL, oldest request first, until the frame's budget is spent
+* At least one finished image goes up per call however big it is, so nothing waits forever
+* Main thread only
+*
+* @return how many textures were uploaded
+*/
+int TextureLoader::upload_pending()
+{
+    m_last_upload_bytes = 0;
+    int upload_count = 0;
+
+    while (!m_pending.empty() && m_last_upload_bytes < m_upload_budget)
+    {
+        PendingTexture& texture = m_pending.front();
+        if (texture.image.wait_for(std::chrono::seconds(0)) != std::future_status::ready) break;
+
+        upload(texture);
+        m_last_upload_bytes += texture.image.get().get_byte_count();
+        upload_count++;
+
+        m_pending.pop_front();
+    }
+
+    return upload_count;
+}
+
+/*
+* Waits for every queued decode and uploads them all, ignoring the budget
+* For when the next frame has to be complete, e.g. benchmarks and screenshots
+*/
+void TextureLoader::finish()
+{
+    while (!m_pending.empty())
+    {
+        upload(m_pending.front());
+        m_pending.pop_front();
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+
+#define GL_GLEXT_PROTOTYPES 1
+#include <vector>
+#include <deque>
+#include <map>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <future>
+#include <condition_variable>
+#include <SDL_opengl.h>
+#include "TextureCache.h"
+
+#define TEXTURE_MAX_DECODE_THREADS 4
+#define TEXTURE_UPLOAD_BUDGET      (1 << 20) // bytes of pixels sent to GL per frame
+
+// a texture name handed out before its pixels are ready
+struct PendingTexture
+{
+    GLuint texture_id;
+    int    tile_count_x, tile_count_y; // 0 unless it becomes a GL_TEXTURE_2D_ARRAY
+    std::shared_future<DecodedImage> image;
+};
+
+/*
+* Decodes images on worker threads so scene loads don't stall the frame
+*
+* load_texture() returns a texture name straight away -- it holds a transparent
+* pixel until upload_pending(), called once a frame on the main thread, fills it in.
+* Uploads stop for the frame once TEXTURE_UPLOAD_BUDGET bytes have gone to GL.
+* Textures are kept by file, so loading the same image again (every respawn,
+* every frame for the font) costs nothing.
+* Anything that keeps a frame drawn with these textures (see RenderCache) checks
+* get_upload_generation(), since a placeholder it drew may have been filled in since.
+*/
+class TextureLoader
+{
+private:
+    static TextureLoader* s_loader;
+
+    int m_upload_budget;
+
+    // decode jobs, same worker setup as Map's chunk builder
+    std::vector<std::thread> m_workers;
+    std::mutex               m_job_mutex;
+    std::condition_variable  m_job_condition;
+    std::deque<std::packaged_task<DecodedImage()>> m_jobs;
+    bool                     m_workers_running = false;
+
+    // main thread only
+    std::deque<PendingTexture>    m_pending;
+    std::map<std::string, GLuint> m_textures;
+    int m_last_upload_bytes = 0;
+    unsigned int m_upload_generation = 0; // goes up with every texture uploaded
+
+    void start_workers();
+    void worker();
+    void upload(const PendingTexture& texture);
+    GLuint request(const char* filepath, int tile_count_x, int tile_count_y);
+
+public:
+    TextureLoader(int upload_budget = TEXTURE_UPLOAD_BUDGET);
+    ~TextureLoader();
+
+    static DecodedImage decode_file(const std::string& filepath);
+    std::shared_future<DecodedImage> decode(const char* filepath);
+
+    GLuint load_texture(const char* filepath);
+    GLuint load_texture_array(const char* filepath, int tile_count_x, int tile_count_y);
+
+    int  upload_pending();
+    void finish();
+
+    void set_upload_budget(int bytes) { m_upload_budget = bytes; }
+
+    int const get_pending_count()     const { return (int)m_pending.size(); }
+    int const get_last_upload_bytes() const { return m_last_upload_bytes; }
+    unsigned int const get_upload_generation() const { return m_upload_generation; }
+
+    static TextureLoader* get() { return s_loader; }
+    static void set(TextureLoader* loader) { s_loader = loader; }
+};
+
+extern TextureLoader g_texture_loader;
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cmath>
+#include "glm/vec2.hpp"
+#include "glm/vec4.hpp"
+
+/*
+* Position, scale and rotation of something drawn in 2D -- everything a
+* sprite or a chunk mesh needs, in 20 bytes instead of a 64 byte mat4
+* Shaders get it as a 2x2 linear part plus a translation (see ShaderProgram::set_model_transform)
+*/
+struct Transform2D
+{
+    glm::vec2 position = glm::vec2(0.0f);
+    glm::vec2 scale = glm::vec2(1.0f);
+    float rotation = 0.0f; // radians, counter-clockwise
+
+    Transform2D() {}
+    Transform2D(glm::vec2 position, glm::vec2 scale = glm::vec2(1.0f), float rotation = 0.0f)
+        : position(position), scale(scale), rotation(rotation) {}
+
+    /*
+    * The 2x2 part, column major -- (x axis, y axis)
+    * Skips the trig when there is no rotation, which is every sprite so far
+    */
+    glm::vec4 get_linear() const
+    {
+        if (rotation == 0.0f) return glm::vec4(scale.x, 0.0f, 0.0f, scale.y);
+
+        float cosine = cosf(rotation);
+        float sine = sinf(rotation);
+        return glm::vec4(cosine * scale.x, sine * scale.x, -sine * scale.y, cosine * scale.y);
+    }
+};
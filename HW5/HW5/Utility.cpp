@@ -1,48 +1,138 @@
 #define LOG(argument) std::cout << argument << '\n'
 #define STB_IMAGE_IMPLEMENTATION
-#define NUMBER_OF_TEXTURES 1
 #define LEVEL_OF_DETAIL    0
 #define TEXTURE_BORDER     0
 #define FONTBANK_SIZE      16
 
 #include "Utility.h"
+#include "Benchmark.h"
+#include "RenderBackend.h"
+#include "TextureLoader.h"
+#include "AssetPack.h"
 #include <SDL_image.h>
 #include "stb_image.h"
 
-GLuint Utility::load_texture(const char* filepath) {
-    int width, height, number_of_components;
-    unsigned char* image = stbi_load(filepath, &width, &height, &number_of_components, STBI_rgb_alpha);
+/*
+* Textures are decoded in the background by the TextureLoader -- the texture
+* is usable straight away but stays transparent until it has been uploaded
+*
+* @param filepath, path to the image
+*/
+GLuint Utility::load_texture(const char* filepath)
+{
+    return TextureLoader::get()->load_texture(filepath);
+}
 
-    if (image == NULL)
-    {
-        LOG("Unable to load image. Make sure the path is correct.");
-        assert(false);
-    }
+/*
+* Loads a tile set as a GL_TEXTURE_2D_ARRAY with one layer per tile, in the background like load_texture
+*
+* @param filepath, path to the tile set image
+* @param tile_count_x, tile_count_y, how many tiles the tile set has across and down
+*/
+GLuint Utility::load_texture_array(const char* filepath, int tile_count_x, int tile_count_y)
+{
+    return TextureLoader::get()->load_texture_array(filepath, tile_count_x, tile_count_y);
+}
+
+/*
+* Loads a sound effect, decoding it from the asset pack's mapping when the pack has it
+*
+* @param filepath, path to the sound
+*/
+Mix_Chunk* Utility::load_sound(const char* filepath)
+{
+    const unsigned char* data;
+    size_t size;
+    if (AssetPack::get()->find(filepath, ASSET_AUDIO, &data, &size)) return Mix_LoadWAV_RW(SDL_RWFromConstMem(data, (int)size), 1);
+
+    return Mix_LoadWAV(filepath);
+}
 
-    GLuint texture_id;
-    glGenTextures(NUMBER_OF_TEXTURES, &texture_id);
+/*
+* Loads music, streamed from the asset pack's mapping when the pack has it
+* The pack stays mapped for the whole run, so the stream never outlives its bytes
+*
+* @param filepath, path to the music
+*/
+Mix_Music* Utility::load_music(const char* filepath)
+{
+    const unsigned char* data;
+    size_t size;
+    if (AssetPack::get()->find(filepath, ASSET_AUDIO, &data, &size)) return Mix_LoadMUS_RW(SDL_RWFromConstMem(data, (int)size), 1);
+
+    return Mix_LoadMUS(filepath);
+}
+
+/*
+* Fills a texture with decoded RGBA pixels
+*
+* @param texture_id, the texture to fill
+* @param width, height, image size in pixels
+* @param pixels, width * height RGBA pixels
+*/
+void Utility::upload_texture(GLuint texture_id, int width, int height, const unsigned char* pixels)
+{
     glBindTexture(GL_TEXTURE_2D, texture_id);
-    glTexImage2D(GL_TEXTURE_2D, LEVEL_OF_DETAIL, GL_RGBA, width, height, TEXTURE_BORDER, GL_RGBA, GL_UNSIGNED_BYTE, image);
+    glTexImage2D(GL_TEXTURE_2D, LEVEL_OF_DETAIL, GL_RGBA, width, height, TEXTURE_BORDER, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+}
 
-    stbi_image_free(image);
+/*
+* Fills a GL_TEXTURE_2D_ARRAY with one layer per tile of a decoded tile set
+* Layers are numbered left to right, top to bottom, like tile ids
+*
+* @param texture_id, the texture to fill
+* @param width, height, tile set size in pixels
+* @param pixels, width * height RGBA pixels
+* @param tile_count_x, tile_count_y, how many tiles the tile set has across and down
+*/
+void Utility::upload_texture_array(GLuint texture_id, int width, int height, const unsigned char* pixels, int tile_count_x, int tile_count_y)
+{
+    int tile_width = width / tile_count_x;
+    int tile_height = height / tile_count_y;
+    int layer_count = tile_count_x * tile_count_y;
 
-    return texture_id;
+    // copy every tile out of the sheet so each layer is contiguous
+    std::vector<unsigned char> layers(tile_width * tile_height * 4 * layer_count);
+    for (int layer = 0; layer < layer_count; layer++)
+    {
+        int tile_left = (layer % tile_count_x) * tile_width;
+        int tile_top = (layer / tile_count_x) * tile_height;
+
+        for (int row = 0; row < tile_height; row++)
+        {
+            memcpy(&layers[((layer * tile_height) + row) * tile_width * 4],
+                &pixels[((tile_top + row) * width + tile_left) * 4],
+                tile_width * 4);
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture_id);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, LEVEL_OF_DETAIL, GL_RGBA, tile_width, tile_height, layer_count, TEXTURE_BORDER, GL_RGBA, GL_UNSIGNED_BYTE, layers.data());
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // merged quads rely on the tile repeating
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
 }
 
 void Utility::draw_text(ShaderProgram* program, GLuint font_texture_id, std::string text, float screen_size, float spacing, glm::vec3 position)
 {
+    RenderTimer timer(RENDER_TEXT);
+
     float width = 1.0f / FONTBANK_SIZE;
     float height = 1.0f / FONTBANK_SIZE;
 
 
+    // interleaved position and uv, 4 corners per character
     std::vector<float> vertices;
-    std::vector<float> texture_coordinates;
 
     for (int i = 0; i < text.size(); i++) {
         // 1. Get their index in the spritesheet, as well as their offset (i.e. their position
@@ -54,41 +144,67 @@ void Utility::draw_text(ShaderProgram* program, GLuint font_texture_id, std::str
         float u_coordinate = (float)(spritesheet_index % FONTBANK_SIZE) / FONTBANK_SIZE;
         float v_coordinate = (float)(spritesheet_index / FONTBANK_SIZE) / FONTBANK_SIZE;
 
-        // 3. Inset the current pair in both vectors
+        // 3. Insert the corners -- top left, bottom left, bottom right, top right
         vertices.insert(vertices.end(), {
-            offset + (-0.5f * screen_size), 0.5f * screen_size,
-            offset + (-0.5f * screen_size), -0.5f * screen_size,
-            offset + (0.5f * screen_size), 0.5f * screen_size,
-            offset + (0.5f * screen_size), -0.5f * screen_size,
-            offset + (0.5f * screen_size), 0.5f * screen_size,
-            offset + (-0.5f * screen_size), -0.5f * screen_size,
-            });
-
-        texture_coordinates.insert(texture_coordinates.end(), {
-            u_coordinate, v_coordinate,
-            u_coordinate, v_coordinate + height,
-            u_coordinate + width, v_coordinate,
-            u_coordinate + width, v_coordinate + height,
-            u_coordinate + width, v_coordinate,
-            u_coordinate, v_coordinate + height,
+            offset + (-0.5f * screen_size), 0.5f * screen_size, u_coordinate, v_coordinate,
+            offset + (-0.5f * screen_size), -0.5f * screen_size, u_coordinate, v_coordinate + height,
+            offset + (0.5f * screen_size), -0.5f * screen_size, u_coordinate + width, v_coordinate + height,
+            offset + (0.5f * screen_size), 0.5f * screen_size, u_coordinate + width, v_coordinate,
             });
     }
 
     // 4. And render all of them using the pairs
-    glm::mat4 model_matrix = glm::mat4(1.0f);
-    model_matrix = glm::translate(model_matrix, position);
+    program->set_model_transform(Transform2D(glm::vec2(position)));
+    RenderBackend* backend = RenderBackend::get();
+    backend->set_layer(RENDER_LAYER_TEXT);
+    backend->use_program(program->get_program_id());
+
+    backend->set_attribute(program->get_position_attribute(), 2, GL_FLOAT, false, 4 * sizeof(float), vertices.data());
+    backend->set_attribute(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 4 * sizeof(float), vertices.data() + 2);
+
+    backend->bind_texture(GL_TEXTURE_2D, font_texture_id, 0);
+    backend->draw_quads((int)text.size());
+
+    backend->disable_attribute(program->get_position_attribute());
+    backend->disable_attribute(program->get_tex_coordinate_attribute());
+}
 
-    program->set_model_matrix(model_matrix);
-    glUseProgram(program->get_program_id());
+/*
+* Shared index buffer for quads drawn as 4 corners
+* Corners are expected as top left, bottom left, bottom right, top right
+* (or any order going around the quad) and each quad becomes two triangles
+*
+* @param quad_count, number of quads that will be drawn with the indices
+*/
+const GLushort* Utility::get_quad_indices(int quad_count)
+{
+    static std::vector<GLushort> indices;
 
-    glVertexAttribPointer(program->get_position_attribute(), 2, GL_FLOAT, false, 0, vertices.data());
-    glEnableVertexAttribArray(program->get_position_attribute());
-    glVertexAttribPointer(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 0, texture_coordinates.data());
-    glEnableVertexAttribArray(program->get_tex_coordinate_attribute());
+    // grows as needed -- every quad after the first reuses the same pattern
+    for (int quad = (int)indices.size() / 6; quad < quad_count; quad++)
+    {
+        GLushort first = (GLushort)(quad * 4);
+        indices.insert(indices.end(), {
+            first, (GLushort)(first + 1), (GLushort)(first + 2),
+            first, (GLushort)(first + 2), (GLushort)(first + 3)
+            });
+    }
 
-    glBindTexture(GL_TEXTURE_2D, font_texture_id);
-    glDrawArrays(GL_TRIANGLES, 0, (int)(text.size() * 6));
+    return indices.data();
+}
 
-    glDisableVertexAttribArray(program->get_position_attribute());
-    glDisableVertexAttribArray(program->get_tex_coordinate_attribute());
+/*
+* 64 bit FNV-1a -- fast and plenty to tell two versions of a file apart
+*
+* @param data, size, bytes to hash
+*/
+uint64_t Utility::hash(const unsigned char* data, size_t size)
+{
+    uint64_t result = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++)
+    {
+        result ^= data[i];
+        result *= 1099511628211ULL;
+    }
+    return result;
 }
\ No newline at end of file
@@ -7,7 +7,9 @@
 
 #define GL_GLEXT_PROTOTYPES 1
 #include <vector>
+#include <cstdint>
 #include <SDL.h>
+#include <SDL_mixer.h>
 #include <SDL_opengl.h>
 #include "glm/mat4x4.hpp"
 #include "glm/gtc/matrix_transform.hpp"
@@ -17,5 +19,12 @@ class Utility {
 public:
     //  METHODS  //
     static GLuint load_texture(const char* filepath);
+    static GLuint load_texture_array(const char* filepath, int tile_count_x, int tile_count_y);
+    static void upload_texture(GLuint texture_id, int width, int height, const unsigned char* pixels);
+    static void upload_texture_array(GLuint texture_id, int width, int height, const unsigned char* pixels, int tile_count_x, int tile_count_y);
+    static Mix_Chunk* load_sound(const char* filepath);
+    static Mix_Music* load_music(const char* filepath);
     static void draw_text(ShaderProgram* program, GLuint font_texture_id, std::string text, float screen_size, float spacing, glm::vec3 position);
+    static const GLushort* get_quad_indices(int quad_count);
+    static uint64_t hash(const unsigned char* data, size_t size);
 };
\ No newline at end of file
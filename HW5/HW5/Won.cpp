@@ -1,29 +1,25 @@
 #include "Won.h"
 #include "Utility.h"
-
-#define LEVEL_WIDTH 14
-#define LEVEL_HEIGHT 8
+#include "EmbeddedLevel.h"
 
 // texture filepaths
 // MAPS
-const char MAP_TILESET_FILEPATH[] = "Tileset.png",
-PLAYER_FILEPATH[] = "Player.png",
-CHAIN_FILEPATH[] = "Chain.png",
-DOOR_FILEPATH[] = "Door.png",
-ENEMY_FILEPATH[] = "Enemy.png",
+const char MAP_TILESET_FILEPATH[] = "tileset.png",
 FONT_FILEPATH[] = "font.png";
 
-unsigned int WON_DATA[] =
-{
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
-    1, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 0, 0, 1,
-    1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
-    1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
-    1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 1
-};
+// tiles and spawns
+const char LEVEL_FILEPATH[] = "levels/won.lvl";
+
+// built into the game too, in case the level file is missing
+constexpr EmbeddedLevelData<14, 8> WON_DATA = make_embedded_level<14, 8>(1.0f, 4, 1,
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+    { 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 },
+    { 1, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 0, 0, 1 },
+    { 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 },
+    { 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 },
+    { 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 },
+    { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 1 });
 
 Won::~Won()
 {
@@ -35,29 +31,37 @@ Won::~Won()
     Mix_FreeMusic(m_state.bgm);
 }
 
+const char* Won::get_level_filepath() const { return LEVEL_FILEPATH; }
+EmbeddedLevel Won::get_embedded_level() const { return WON_DATA.get_level(); }
+
 void Won::initialise()
 {
+    m_render_cache.invalidate();
+
+    LevelFile level;
+    EmbeddedLevel fallback = get_embedded_level();
+    open_level(level, get_level_filepath(), &fallback);
 
     GLuint map_texture_id = Utility::load_texture(MAP_TILESET_FILEPATH);
-    m_state.map = new Map(LEVEL_WIDTH, LEVEL_HEIGHT, WON_DATA, map_texture_id, 1.0f, 4, 1);
+    GLuint map_array_texture_id = Utility::load_texture_array(MAP_TILESET_FILEPATH, level.get_tile_count_x(), level.get_tile_count_y());
+    delete m_state.map;
+    m_state.map = new Map(level, map_texture_id, map_array_texture_id);
+    load_entity_textures();
 
     // PLAYER
-    m_state.player = new Entity();
-    m_state.player->m_texture_id = Utility::load_texture(PLAYER_FILEPATH);
+    m_state.player = new Entity(PLAYER_ARCHETYPE);
     m_state.player->disable();
 
     // CHAIN
-    m_state.chain = new Entity();
-    m_state.chain->m_texture_id = Utility::load_texture(CHAIN_FILEPATH);
+    m_state.chain = new Entity(CHAIN_ARCHETYPE);
     m_state.chain->disable();
 
     // DOOR
-    m_state.door = new Entity();
-    m_state.door->m_texture_id = Utility::load_texture(DOOR_FILEPATH);
+    m_state.door = new Entity(DOOR_ARCHETYPE);
     m_state.door->disable();
 
     // ENEMY
-    m_state.enemies = new Entity();
+    m_state.enemies = new Entity(PATROL_ENEMY_ARCHETYPE);
     m_state.player->disable();
 
     /*
@@ -65,7 +69,7 @@ void Won::initialise()
 
     Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 4096);
 
-    m_state.bgm = Mix_LoadMUS("crowd_hammer.mp3");
+    m_state.bgm = Utility::load_music("crowd_hammer.mp3");
     Mix_PlayMusic(m_state.bgm, -1);
     Mix_VolumeMusic(10.0f);
 
@@ -82,12 +86,18 @@ void Won::update(float delta_time)
 
 void Won::render(ShaderProgram* program)
 {
-    Utility::draw_text(program, Utility::load_texture(FONT_FILEPATH), "YOU WIN", 0.5f,
-        -0.2f, glm::vec3(-3.0f, 2.0f, 0.0f));
-    Utility::draw_text(program, Utility::load_texture(FONT_FILEPATH), "Escaped", 0.5f,
-        -0.2f, glm::vec3(-3.0f, 0.0f, 0.0f));
-    m_state.map->render(program);
-    m_state.player->render(program);
-    m_state.chain->render(program);
-    m_state.door->render(program);
+    // drawn once into the cache, then reused every frame
+    if (m_render_cache.begin(program, m_state.map->get_revision()))
+    {
+        Utility::draw_text(program, Utility::load_texture(FONT_FILEPATH), "YOU WIN", 0.5f,
+            -0.2f, glm::vec3(-3.0f, 2.0f, 0.0f));
+        Utility::draw_text(program, Utility::load_texture(FONT_FILEPATH), "Escaped", 0.5f,
+            -0.2f, glm::vec3(-3.0f, 0.0f, 0.0f));
+        m_state.map->render();
+        m_state.player->render(program);
+        m_state.chain->render(program);
+        m_state.door->render(program);
+        m_render_cache.end();
+    }
+    m_render_cache.present(program);
 }
\ No newline at end of file
@@ -28,6 +28,8 @@
 #include "ShaderProgram.h"
 #include "cmath"
 #include <ctime>
+#include <cstring>
+#include <algorithm>
 #include <vector>
 #include "Entity.h"
 #include "Map.h"
@@ -39,6 +41,16 @@
 #include "Level3.h"
 #include "Won.h"
 #include "Lost.h"
+#include "Benchmark.h"
+#include "RenderBackend.h"
+#include "RenderQueue.h"
+#include "ParticleSystem.h"
+#include "Rope.h"
+#include "Lighting.h"
+#include "TextureLoader.h"
+#include "TextureCache.h"
+#include "AssetPack.h"
+#include "LevelCompiler.h"
 
 
 // CONSTS
@@ -59,7 +71,13 @@ BG_OPACITY = 1.0f;
 
 // shaders
 const char V_SHADER_PATH[] = "shaders/vertex_textured.glsl",
-F_SHADER_PATH[] = "shaders/fragment_textured.glsl";
+F_SHADER_PATH[] = "shaders/fragment_textured.glsl",
+V_TILE_ARRAY_SHADER_PATH[] = "shaders/vertex_tile_array.glsl",
+F_TILE_ARRAY_SHADER_PATH[] = "shaders/fragment_tile_array.glsl",
+V_TILEMAP_SHADER_PATH[] = "shaders/vertex_tilemap.glsl",
+F_TILEMAP_SHADER_PATH[] = "shaders/fragment_tilemap.glsl",
+V_LIGHT_SHADER_PATH[] = "shaders/vertex_light.glsl",
+F_LIGHT_SHADER_PATH[] = "shaders/fragment_light.glsl";
 
 const float MILLISECONDS_IN_SECOND = 1000.0;
 
@@ -78,8 +96,25 @@ SDL_Window* g_display_window;
 bool g_game_is_running = true;
 
 ShaderProgram g_shader_program;
+ShaderProgram g_tile_array_program; // used by maps in MAP_RENDER_MESH mode
+ShaderProgram g_tilemap_program;    // used by maps in MAP_RENDER_TILE_TEXTURE mode
+ShaderProgram g_light_program;      // draws light polygons into the light buffer
 glm::mat4 g_view_matrix, g_projection_matrix;
 
+// draws are sorted by layer, program and texture before they reach GL
+RenderQueue g_render_queue;
+bool g_use_render_queue = true;
+
+// jump dust, chain impacts and enemy kills
+ParticleSystem g_effects(PARTICLE_EFFECT_CAPACITY, 0.15f, -4.0f);
+
+// the grappling chain between the player and the hook
+Rope g_rope;
+
+// the player's lantern, the chain tip and the door torch, with the tiles casting shadows
+Lighting g_lighting;
+bool g_lighting_enabled = false;
+
 float g_previous_ticks = 0.0f;
 float g_accumulator = 0.0f;
 
@@ -96,8 +131,12 @@ void switch_to_scene(Scene* scene)
     next_level_index += 1;
     g_current_scene = scene;
     g_current_scene->initialise();
+    g_effects.clear();
+    g_rope = Rope(); // the old scene's chain went with it
 }
 
+void initialise_renderer(int viewport_width, int viewport_height);
+
 void initialise()
 {
     //  VIDEO  //
@@ -114,8 +153,22 @@ void initialise()
     glewInit();
 #endif
 
+    initialise_renderer(VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
+}
+
+/*
+* Everything after the GL context exists -- shaders, camera, scenes
+* Shared by the game window and the offscreen benchmark
+*
+* @param viewport_width, viewport_height, size of the render target in pixels
+*/
+void initialise_renderer(int viewport_width, int viewport_height)
+{
     //  GENERAL  //
-    glViewport(VIEWPORT_X, VIEWPORT_Y, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
+    // loose files are used for anything the pack doesn't have, or if there is no pack
+    AssetPack::get()->open(ASSET_PACK_FILEPATH);
+
+    glViewport(VIEWPORT_X, VIEWPORT_Y, viewport_width, viewport_height);
 
     g_shader_program.load(V_SHADER_PATH, F_SHADER_PATH);
 
@@ -125,6 +178,24 @@ void initialise()
     g_shader_program.set_projection_matrix(g_projection_matrix);
     g_shader_program.set_view_matrix(g_view_matrix);
 
+    g_tile_array_program.load(V_TILE_ARRAY_SHADER_PATH, F_TILE_ARRAY_SHADER_PATH);
+    g_tile_array_program.set_projection_matrix(g_projection_matrix);
+    g_tile_array_program.set_view_matrix(g_view_matrix);
+
+    g_tilemap_program.load(V_TILEMAP_SHADER_PATH, F_TILEMAP_SHADER_PATH);
+    g_tilemap_program.set_projection_matrix(g_projection_matrix);
+    g_tilemap_program.set_view_matrix(g_view_matrix);
+
+    Map::set_programs(&g_tile_array_program, &g_tilemap_program);
+
+    g_light_program.load(V_LIGHT_SHADER_PATH, F_LIGHT_SHADER_PATH);
+    g_light_program.set_projection_matrix(g_projection_matrix);
+    g_light_program.set_view_matrix(g_view_matrix);
+    g_lighting.set_program(&g_light_program);
+
+    g_effects.set_texture_id(ParticleSystem::create_dot_texture(16));
+    ParticleSystem::set(&g_effects);
+
     glUseProgram(g_shader_program.get_program_id());
 
     glClearColor(BG_RED, BG_BLUE, BG_GREEN, BG_OPACITY);
@@ -206,6 +277,15 @@ void process_input()
                 // Pause game with a keystroke
                 is_paused = !is_paused;
                 break;
+            case SDLK_m:
+                // Switch between the chunk mesh and tile texture map renderers
+                if (Map::get_render_mode() == MAP_RENDER_MESH) Map::set_render_mode(MAP_RENDER_TILE_TEXTURE);
+                else Map::set_render_mode(MAP_RENDER_MESH);
+                break;
+            case SDLK_o:
+                // Turn the lights on and off
+                g_lighting_enabled = !g_lighting_enabled;
+                break;
             }
         }
     }
@@ -264,6 +344,17 @@ void process_input()
     }
 }
 
+void update_camera()
+{
+    // camera follow
+    g_view_matrix = glm::mat4(1.0f);
+    if (next_level_index != 0)
+    {
+        g_view_matrix = glm::translate(g_view_matrix, glm::vec3(-g_current_scene->m_state.player->get_position().x, -2.25f
+            - g_current_scene->m_state.player->get_position().y, 0.0f));
+    }
+}
+
 void update()
 {
     //  DELTA TIME / FIXED TIME STEP CALCULATION  //
@@ -281,29 +372,19 @@ void update()
 
     if (!is_paused)
     {
-        if (g_current_scene->m_state.player->chain_timer > 0.0f)
-        {
-            g_current_scene->m_state.player->move_to_target(g_current_scene->m_state.chain->get_position());
-            g_current_scene->m_state.player->m_has_gravity = false;
-        }
-        else g_current_scene->m_state.player->m_has_gravity = true;
-
         while (delta_time >= FIXED_TIMESTEP) {
             //  UPDATING THE SCENE (i.e. map, character, enemies...)  //
             g_current_scene->update(FIXED_TIMESTEP);
+            g_rope.update(FIXED_TIMESTEP, g_current_scene->m_state.player, g_current_scene->m_state.chain, g_current_scene->m_state.map);
+            Map::advance_animation(FIXED_TIMESTEP);
+            g_effects.update(FIXED_TIMESTEP);
 
             delta_time -= FIXED_TIMESTEP;
         }
 
         g_accumulator = delta_time;
 
-        // camera follow
-        g_view_matrix = glm::mat4(1.0f);
-        if (next_level_index != 0)
-        {
-            g_view_matrix = glm::translate(g_view_matrix, glm::vec3(-g_current_scene->m_state.player->get_position().x, -2.25f
-                - g_current_scene->m_state.player->get_position().y, 0.0f));
-        }
+        update_camera();
 
         // go to next scene if door flagged (or main menu flagged)
         if (g_current_scene->m_state.door->level_finished) switch_to_scene(g_levels[next_level_index]);
@@ -329,14 +410,61 @@ void update()
     if (number_of_lives == 0) switch_to_scene(g_level_lost);
 }
 
-void render()
+/*
+* Puts the lights in the current scene -- only levels with an active player are lit
+*
+* @return true if there is anything to light
+*/
+bool add_scene_lights()
+{
+    g_lighting.clear_lights();
+
+    Entity* player = g_current_scene->m_state.player;
+    if (!player->get_active_state()) return false;
+
+    g_lighting.add_light({ glm::vec2(player->get_position()), 4.0f, glm::vec4(1.0f, 0.85f, 0.6f, 1.0f) });
+
+    Entity* chain = g_current_scene->m_state.chain;
+    if (chain->get_active_state()) g_lighting.add_light({ glm::vec2(chain->get_position()), 2.5f, glm::vec4(0.6f, 0.8f, 1.0f, 0.9f) });
+
+    Entity* door = g_current_scene->m_state.door;
+    if (door != NULL) g_lighting.add_light({ glm::vec2(door->get_position()), 3.0f, glm::vec4(1.0f, 0.6f, 0.3f, 1.0f) });
+
+    return true;
+}
+
+void render_scene()
 {
+    // textures decoded since the last frame, up to the upload budget
+    TextureLoader::get()->upload_pending();
+
     g_shader_program.set_view_matrix(g_view_matrix);
+    g_tile_array_program.set_view_matrix(g_view_matrix);
+    g_tilemap_program.set_view_matrix(g_view_matrix);
+    g_light_program.set_view_matrix(g_view_matrix);
+
+    // load map chunks around the camera -- the camera sits at the inverse of the view translation
+    glm::vec3 camera_position = -glm::vec3(g_view_matrix[3]);
+    g_current_scene->m_state.map->stream_chunks(camera_position);
+
+    // lights go into their own buffer first -- switching framebuffers would flush the queue
+    bool is_lit = g_lighting_enabled && add_scene_lights();
+    if (is_lit) g_lighting.render_lights(g_current_scene->m_state.map);
 
     glClear(GL_COLOR_BUFFER_BIT);
 
     //  RENDERING THE SCENE (i.e. map, character, enemies...)  //
+    if (g_use_render_queue) g_render_queue.begin();
     g_current_scene->render(&g_shader_program);
+    g_rope.render(&g_shader_program, g_current_scene->m_state.chain->get_texture_id());
+    g_effects.render(&g_shader_program);
+    if (is_lit) g_lighting.composite(&g_shader_program);
+    if (g_use_render_queue) g_render_queue.end();
+}
+
+void render()
+{
+    render_scene();
     SDL_GL_SwapWindow(g_display_window);
 }
 
@@ -351,9 +479,602 @@ void shutdown()
     delete g_level_3;
 }
 
+/*
+* Renders a scene headless and reports the CPU time per frame
+* usage: HW5 --bench [scene] [frames] [width] [height] [output.png]
+* scene is an index into g_levels, the last frame is saved if a PNG path is given
+* --bench-lights takes the same arguments and renders with the lights on
+*/
+int run_benchmark(int argc, char* argv[])
+{
+    int scene_index = argc > 2 ? atoi(argv[2]) : 1;
+    int frame_count = argc > 3 ? atoi(argv[3]) : 1000;
+    int width = argc > 4 ? atoi(argv[4]) : VIEWPORT_WIDTH;
+    int height = argc > 5 ? atoi(argv[5]) : VIEWPORT_HEIGHT;
+    const char* png_filepath = argc > 6 ? argv[6] : NULL;
+
+    if (scene_index < 0 || scene_index > 5 || frame_count <= 0 || width <= 0 || height <= 0)
+    {
+        std::cout << "usage: HW5 --bench [scene 0-5] [frames] [width] [height] [output.png]" << std::endl;
+        return 1;
+    }
+
+    if (!Benchmark::create_offscreen_context(width, height)) return 1;
+    initialise_renderer(width, height);
+
+    std::cout << "shader cache:  " << ShaderProgram::get_binary_count() << " of " << ShaderProgram::get_program_count()
+        << " programs from binaries, " << ShaderProgram::get_seconds_saved() * 1000.0 << " ms saved" << std::endl;
+
+    // how long the scene load blocks, then how long until its textures are all in
+    std::chrono::steady_clock::time_point load_start = std::chrono::steady_clock::now();
+    next_level_index = scene_index;
+    switch_to_scene(g_levels[scene_index]);
+    std::chrono::steady_clock::time_point loaded = std::chrono::steady_clock::now();
+    TextureLoader::get()->finish();
+    std::chrono::steady_clock::time_point textures_ready = std::chrono::steady_clock::now();
+
+    double render_seconds = 0.0;
+    double finish_seconds = 0.0;
+    RenderTimer::s_enabled = true;
+
+    for (int frame = 0; frame < frame_count; frame++)
+    {
+        g_current_scene->update(FIXED_TIMESTEP);
+        g_effects.update(FIXED_TIMESTEP);
+        update_camera();
+
+        // CPU side submission, then wait for the GPU separately
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        render_scene();
+        std::chrono::steady_clock::time_point submitted = std::chrono::steady_clock::now();
+        glFinish();
+        std::chrono::steady_clock::time_point finished = std::chrono::steady_clock::now();
+
+        render_seconds += std::chrono::duration<double>(submitted - start).count();
+        finish_seconds += std::chrono::duration<double>(finished - submitted).count();
+    }
+
+    RenderTimer::s_enabled = false;
+
+    double map_seconds = RenderTimer::s_seconds[RENDER_MAP];
+    double entity_seconds = RenderTimer::s_seconds[RENDER_ENTITY];
+    double text_seconds = RenderTimer::s_seconds[RENDER_TEXT];
+    double particle_seconds = RenderTimer::s_seconds[RENDER_PARTICLES];
+    double lighting_seconds = RenderTimer::s_seconds[RENDER_LIGHTING];
+    double other_seconds = render_seconds - map_seconds - entity_seconds - text_seconds - particle_seconds - lighting_seconds;
+
+    // milliseconds per frame
+    double to_ms = 1000.0 / frame_count;
+    std::cout << "scene " << scene_index << ", " << frame_count << " frames at " << width << "x" << height << std::endl;
+    std::cout << "scene load:    " << std::chrono::duration<double>(loaded - load_start).count() * 1000.0 << " ms, textures ready after "
+        << std::chrono::duration<double>(textures_ready - load_start).count() * 1000.0 << " ms" << std::endl;
+    Map* map = g_current_scene->m_state.map;
+    std::cout << "tile data:     " << map->get_tile_byte_count() << " bytes for " << map->get_width() << "x" << map->get_height()
+        << " tiles of " << map->get_tile_index_size() << " byte ids and their solidity (" << (size_t)map->get_width() * map->get_height() * sizeof(unsigned int)
+        << " bytes as unsigned ints)" << std::endl;
+    std::cout << "render (CPU):  " << render_seconds * to_ms << " ms/frame" << std::endl;
+    std::cout << "  map:         " << map_seconds * to_ms << " ms/frame" << std::endl;
+    std::cout << "  entities:    " << entity_seconds * to_ms << " ms/frame" << std::endl;
+    std::cout << "  text:        " << text_seconds * to_ms << " ms/frame" << std::endl;
+    std::cout << "  particles:   " << particle_seconds * to_ms << " ms/frame" << std::endl;
+    std::cout << "  lighting:    " << lighting_seconds * to_ms << " ms/frame";
+    if (g_lighting_enabled) std::cout << " (" << g_lighting.get_light_count() << " lights, " << g_lighting.get_last_edge_count()
+        << " edges, " << g_lighting.get_last_ray_count() << " rays)";
+    std::cout << std::endl;
+    std::cout << "  other:       " << other_seconds * to_ms << " ms/frame" << std::endl;
+    std::cout << "glFinish wait: " << finish_seconds * to_ms << " ms/frame" << std::endl;
+
+    // saved before the recording frames below, which still clear the framebuffer
+    if (png_filepath != NULL) Benchmark::save_png(png_filepath, width, height);
+
+    // one more frame through the recording backend to count what gets submitted,
+    // in call order and then sorted by the render queue
+    for (int sorted = 0; sorted < 2; sorted++)
+    {
+        RecordingRenderBackend recording_backend(false);
+        g_use_render_queue = sorted == 1;
+        RenderBackend::set(&recording_backend);
+        render_scene();
+        RenderBackend::set(&g_gl_render_backend);
+
+        RenderStats stats = recording_backend.get_stats();
+        std::cout << (sorted ? "sorted:" : "unsorted:") << std::endl;
+        std::cout << "  draw calls: " << stats.draw_calls << ", quads: " << stats.quads
+            << ", program changes: " << stats.program_changes << ", texture changes: " << stats.texture_changes
+            << ", uniform updates: " << stats.uniform_updates << std::endl;
+        std::cout << "  vertex bytes: " << stats.vertex_bytes << ", index bytes: " << stats.index_bytes << std::endl;
+    }
+    g_use_render_queue = true;
+
+    return 0;
+}
+
+// what one frame of a scene should submit, right after it loads with nothing moved
+struct RenderCheck
+{
+    int draw_calls, quads, program_changes, texture_changes, uniform_updates, vertex_bytes;
+};
+
+// [scene][unsorted, sorted] as { draws, quads, programs, textures, uniforms, vertex bytes }
+// -- update these when a change to what gets drawn is meant to change them
+const RenderCheck RENDER_CHECK_EXPECTED[6][2] =
+{
+    { {  1,   1, 5, 1,  6,   64 }, { 1,   1, 5, 1,  6,   64 } }, // cached, only the present
+    { {  7, 106, 7, 5, 20, 6624 }, { 7, 106, 6, 5, 16, 6624 } },
+    { {  4,   7, 6, 4, 14,  320 }, { 4,   7, 6, 4, 12,  320 } },
+    { {  4,   9, 6, 4, 14,  384 }, { 4,   9, 6, 4, 12,  384 } },
+    { {  1,   1, 5, 1,  6,   64 }, { 1,   1, 5, 1,  6,   64 } }, // cached
+    { {  1,   1, 5, 1,  6,   64 }, { 1,   1, 5, 1,  6,   64 } }, // cached
+};
+
+/*
+* Records one frame of every scene, in call order and through the render queue,
+* and checks the counts against RENDER_CHECK_EXPECTED. The queue may only take
+* state changes away -- both orders have to draw the same quads from the same bytes
+* usage: HW5 --check-render
+*
+* @return 0 if every scene matched, 1 otherwise
+*/
+int run_render_check(int argc, char* argv[])
+{
+    if (!Benchmark::create_offscreen_context(VIEWPORT_WIDTH, VIEWPORT_HEIGHT)) return 1;
+    initialise_renderer(VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
+
+    int failures = 0;
+    for (int scene_index = 0; scene_index < 6; scene_index++)
+    {
+        next_level_index = scene_index;
+        switch_to_scene(g_levels[scene_index]);
+        TextureLoader::get()->finish();
+        update_camera();
+
+        // streams the chunks in and loads what only render asks for (the font), then fills
+        // any render cache with the finished textures, so the recorded frames are the steady ones
+        render_scene();
+        TextureLoader::get()->finish();
+        render_scene();
+
+        RenderStats stats[2];
+        for (int sorted = 0; sorted < 2; sorted++)
+        {
+            RecordingRenderBackend recording_backend(false);
+            g_use_render_queue = sorted == 1;
+            RenderBackend::set(&recording_backend);
+            render_scene();
+            RenderBackend::set(&g_gl_render_backend);
+            stats[sorted] = recording_backend.get_stats();
+
+            const RenderCheck& expected = RENDER_CHECK_EXPECTED[scene_index][sorted];
+            RenderCheck actual = { stats[sorted].draw_calls, stats[sorted].quads, stats[sorted].program_changes,
+                stats[sorted].texture_changes, stats[sorted].uniform_updates, stats[sorted].vertex_bytes };
+            bool is_match = memcmp(&expected, &actual, sizeof(RenderCheck)) == 0;
+            if (!is_match) failures++;
+
+            std::cout << "scene " << scene_index << (sorted ? " sorted:   " : " unsorted: ") << (is_match ? "ok  " : "FAIL")
+                << " { " << actual.draw_calls << ", " << actual.quads << ", " << actual.program_changes << ", "
+                << actual.texture_changes << ", " << actual.uniform_updates << ", " << actual.vertex_bytes << " }";
+            if (!is_match) std::cout << " expected { " << expected.draw_calls << ", " << expected.quads << ", " << expected.program_changes << ", "
+                << expected.texture_changes << ", " << expected.uniform_updates << ", " << expected.vertex_bytes << " }";
+            std::cout << std::endl;
+        }
+        g_use_render_queue = true;
+
+        if (stats[1].draw_calls > stats[0].draw_calls || stats[1].quads != stats[0].quads || stats[1].vertex_bytes != stats[0].vertex_bytes
+            || stats[1].program_changes > stats[0].program_changes || stats[1].texture_changes > stats[0].texture_changes)
+        {
+            std::cout << "scene " << scene_index << ": the render queue changed what gets drawn, not just the order" << std::endl;
+            failures++;
+        }
+    }
+
+    std::cout << (failures == 0 ? "render check passed" : "render check FAILED") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
+
+/*
+* The tile edits run_map_mode_check makes -- a row through the middle of the view
+* holding an empty tile, the tile set's tiles past the end of it (which wrap) and
+* an id too big for a byte, so a mapped level gets copied and then widened
+* 512 is a multiple of 256, so it would read back as an empty tile if it were cut to a byte
+*
+* @param map, the current scene's map
+*
+* @return false if the map didn't read back an edit as it was made
+*/
+bool edit_map_for_check(Map* map)
+{
+    unsigned int layer_count = map->get_tile_count_x() * map->get_tile_count_y();
+    unsigned int tiles[] = { 0, 1, layer_count - 1, layer_count, layer_count + 2, 512 };
+    int tile_count = sizeof(tiles) / sizeof(tiles[0]);
+
+    // kept inside the map -- the screens without a player look at its top left corner
+    glm::vec3 camera_position = -glm::vec3(g_view_matrix[3]);
+    int first_x = (int)floorf(camera_position.x / map->get_tile_size() + 0.5f) - tile_count / 2;
+    int y = (int)floorf(-camera_position.y / map->get_tile_size() + 0.5f);
+    first_x = std::max(std::min(first_x, map->get_width() - tile_count), 0);
+    y = std::max(std::min(y, map->get_height() - 1), 0);
+
+    bool is_ok = true;
+    for (int i = 0; i < tile_count && first_x + i < map->get_width(); i++)
+    {
+        map->set_tile(first_x + i, y, tiles[i]);
+        if (map->get_tile(first_x + i, y) != tiles[i]) is_ok = false;
+    }
+    return is_ok;
+}
+
+/*
+* Renders every scene's map as chunk meshes and as a tile index texture and
+* checks the two come out pixel for pixel the same -- once as loaded, then again
+* after edit_map_for_check, with the tile animations part way through
+* usage: HW5 --check-map-modes
+*
+* @return 0 if every scene matched, 1 otherwise
+*/
+int run_map_mode_check(int argc, char* argv[])
+{
+    if (!Benchmark::create_offscreen_context(VIEWPORT_WIDTH, VIEWPORT_HEIGHT)) return 1;
+    initialise_renderer(VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
+
+    // so the animated tiles aren't all on their first frame
+    Map::advance_animation(0.9f);
+
+    MapRenderMode modes[2] = { MAP_RENDER_MESH, MAP_RENDER_TILE_TEXTURE };
+    int failures = 0;
+    for (int scene_index = 0; scene_index < 6; scene_index++)
+    {
+        for (int is_edited = 0; is_edited < 2; is_edited++)
+        {
+            std::vector<unsigned char> pixels[2];
+            int index_sizes[2] = { 0, 0 };
+            for (int mode = 0; mode < 2; mode++)
+            {
+                // the scene is loaded again for each mode, which also throws away any cached frame
+                Map::set_render_mode(modes[mode]);
+                next_level_index = scene_index;
+                switch_to_scene(g_levels[scene_index]);
+                update_camera();
+
+                render_scene();
+                TextureLoader::get()->finish();
+
+                // edited once its chunks and tile index texture are in, so both get patched rather than built
+                Map* map = g_current_scene->m_state.map;
+                index_sizes[0] = map->get_tile_index_size();
+                if (is_edited && !edit_map_for_check(map))
+                {
+                    std::cout << "scene " << scene_index << ": a tile read back different from what was set" << std::endl;
+                    failures++;
+                }
+                index_sizes[1] = map->get_tile_index_size();
+
+                render_scene();
+                Benchmark::read_pixels(VIEWPORT_WIDTH, VIEWPORT_HEIGHT, pixels[mode]);
+            }
+
+            int different_pixels = 0;
+            for (size_t i = 0; i < pixels[0].size(); i += 4)
+            {
+                if (memcmp(&pixels[0][i], &pixels[1][i], 4) != 0) different_pixels++;
+            }
+            if (different_pixels != 0) failures++;
+
+            std::cout << "scene " << scene_index << (is_edited ? " edited: " : " loaded: ") << (different_pixels == 0 ? "ok  " : "FAIL")
+                << " " << different_pixels << " pixels differ";
+            if (is_edited) std::cout << ", ids " << index_sizes[0] << " -> " << index_sizes[1] << " bytes";
+            std::cout << std::endl;
+        }
+    }
+    Map::set_render_mode(MAP_RENDER_MESH);
+
+    std::cout << (failures == 0 ? "map mode check passed" : "map mode check FAILED") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
+
+/*
+* Times the particle update on its own -- no window or GL context needed
+* usage: HW5 --bench-particles [count] [frames]
+* Particles that die are replaced every frame, so count of them stay alive throughout
+*/
+int run_particle_benchmark(int argc, char* argv[])
+{
+    int particle_count = argc > 2 ? atoi(argv[2]) : 100000;
+    int frame_count = argc > 3 ? atoi(argv[3]) : 1000;
+
+    if (particle_count <= 0 || frame_count <= 0)
+    {
+        std::cout << "usage: HW5 --bench-particles [count] [frames]" << std::endl;
+        return 1;
+    }
+
+    ParticleSystem particles(particle_count, 0.15f, -4.0f);
+
+    double update_seconds = 0.0;
+    double vertex_seconds = 0.0;
+    int emitted = 0;
+
+    for (int frame = 0; frame < frame_count; frame++)
+    {
+        int missing = particle_count - particles.get_count();
+        particles.emit(glm::vec3(0.0f), missing, 3.0f, 2.0f);
+        emitted += missing;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        particles.update(FIXED_TIMESTEP);
+        std::chrono::steady_clock::time_point updated = std::chrono::steady_clock::now();
+        particles.build_vertices();
+        std::chrono::steady_clock::time_point built = std::chrono::steady_clock::now();
+
+        update_seconds += std::chrono::duration<double>(updated - start).count();
+        vertex_seconds += std::chrono::duration<double>(built - updated).count();
+    }
+
+    double to_ms = 1000.0 / frame_count;
+    std::cout << particle_count << " particles, " << frame_count << " frames, "
+        << emitted / frame_count << " respawned per frame" << std::endl;
+    std::cout << "update:   " << update_seconds * to_ms << " ms/frame" << std::endl;
+    std::cout << "vertices: " << vertex_seconds * to_ms << " ms/frame" << std::endl;
+
+    return 0;
+}
+
+/*
+* Times Map::is_solid_general(), which is what Map::is_solid() runs, against
+* the compile time power of two lookup, over the same random positions
+* usage: HW5 --bench-collision [level.lvl] [queries]
+* The level needs a tile size of 1, and nothing touches GL
+*/
+int run_collision_benchmark(int argc, char* argv[])
+{
+    std::string filepath = argc > 2 ? argv[2] : "levels/level1.lvl";
+    int query_count = argc > 3 ? atoi(argv[3]) : 10000000;
+
+    LevelFile level;
+    if (query_count <= 0 || !level.open(filepath) || level.get_tile_size() != 1.0f)
+    {
+        std::cout << "usage: HW5 --bench-collision [level.lvl] [queries] -- the level needs a tile size of 1" << std::endl;
+        return 1;
+    }
+    Map map(level, 0, 0);
+
+    // a tile of margin around the map, so some queries land outside it
+    // the positions are reused so the loops time the lookups rather than reading the positions in
+    std::vector<glm::vec3> positions(4096);
+    srand(1);
+    for (glm::vec3& position : positions)
+    {
+        position.x = (rand() / (float)RAND_MAX) * (map.get_width() + 2) - 1.5f;
+        position.y = -(rand() / (float)RAND_MAX) * (map.get_height() + 2) + 1.5f;
+        position.z = 0.0f;
+    }
+
+    int general_hits = 0;
+    int fixed_hits = 0;
+    int mismatches = 0;
+    float penetration_x, penetration_y;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < query_count; i++) general_hits += map.is_solid_general(positions[i & 4095], &penetration_x, &penetration_y);
+    std::chrono::steady_clock::time_point general_done = std::chrono::steady_clock::now();
+    for (int i = 0; i < query_count; i++) fixed_hits += map.is_solid_fixed<0>(positions[i & 4095], &penetration_x, &penetration_y);
+    std::chrono::steady_clock::time_point fixed_done = std::chrono::steady_clock::now();
+
+    // and some far off the map, where the fixed point conversion is clamped
+    for (float distance : { 40000.0f, 1e9f, -40000.0f, -1e9f })
+    {
+        positions.push_back(glm::vec3(distance, -1.0f, 0.0f));
+        positions.push_back(glm::vec3(1.0f, distance, 0.0f));
+    }
+    for (const glm::vec3& position : positions)
+    {
+        float general_x, general_y;
+        bool general = map.is_solid_general(position, &general_x, &general_y);
+        bool fixed = map.is_solid_fixed<0>(position, &penetration_x, &penetration_y);
+        mismatches += general != fixed || general_x != penetration_x || general_y != penetration_y;
+    }
+
+    double to_ns = 1e9 / query_count;
+    std::cout << filepath << ": " << map.get_width() << "x" << map.get_height() << " tiles, " << query_count << " queries" << std::endl;
+    std::cout << "general:  " << std::chrono::duration<double>(general_done - start).count() * to_ns << " ns/query, "
+        << general_hits << " solid" << std::endl;
+    std::cout << "fixed:    " << std::chrono::duration<double>(fixed_done - general_done).count() * to_ns << " ns/query, "
+        << fixed_hits << " solid" << std::endl;
+    std::cout << mismatches << " queries disagree" << std::endl;
+
+    return 0;
+}
+
+/*
+* Times spawning enemies by copying one, and updating them all on a level
+* usage: HW5 --bench-entities [level.lvl] [count] [frames]
+* Enemies only read their archetype, so a spawn copies sizeof(Entity) bytes and nothing touches GL
+*/
+int run_entity_benchmark(int argc, char* argv[])
+{
+    std::string filepath = argc > 2 ? argv[2] : "levels/level1.lvl";
+    int entity_count = argc > 3 ? atoi(argv[3]) : 100000;
+    int frame_count = argc > 4 ? atoi(argv[4]) : 100;
+
+    LevelFile level;
+    if (entity_count <= 0 || frame_count <= 0 || !level.open(filepath))
+    {
+        std::cout << "usage: HW5 --bench-entities [level.lvl] [count] [frames]" << std::endl;
+        return 1;
+    }
+    Map map(level, 0, 0);
+
+    Entity player(PLAYER_ARCHETYPE, level.get_spawn_position(PLAYER));
+    Entity enemy(PATROL_ENEMY_ARCHETYPE, level.get_spawn_position(ENEMY));
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<Entity> enemies(entity_count, enemy);
+    std::chrono::steady_clock::time_point spawned = std::chrono::steady_clock::now();
+
+    for (int frame = 0; frame < frame_count; frame++)
+    {
+        for (Entity& each : enemies) each.update(FIXED_TIMESTEP, &player, NULL, 0, &map);
+    }
+    std::chrono::steady_clock::time_point updated = std::chrono::steady_clock::now();
+
+    std::cout << filepath << ": " << entity_count << " enemies, " << frame_count << " frames" << std::endl;
+    std::cout << "per entity: " << sizeof(Entity) << " bytes, " << sizeof(EntityArchetype) << " byte archetypes shared by "
+        << (int)ENTITY_ARCHETYPE_COUNT << " kinds" << std::endl;
+    std::cout << "spawn:      " << std::chrono::duration<double>(spawned - start).count() * 1e9 / entity_count << " ns/entity" << std::endl;
+    std::cout << "update:     " << std::chrono::duration<double>(updated - spawned).count() * 1000.0 / frame_count << " ms/frame" << std::endl;
+
+    return 0;
+}
+
+/*
+* Times loading every texture the game uses, decoding the PNGs against reading the texture cache
+* usage: HW5 --bench-textures [iterations]
+* The caches are made first if they are missing, and nothing touches GL
+*/
+int run_texture_benchmark(int argc, char* argv[])
+{
+    int iteration_count = argc > 2 ? atoi(argv[2]) : 20;
+    if (iteration_count <= 0)
+    {
+        std::cout << "usage: HW5 --bench-textures [iterations]" << std::endl;
+        return 1;
+    }
+
+    const char* filepaths[] = { "tileset.png", "Player.png", "Chain.png", "Door.png", "Enemy.png", "font.png" };
+
+    double png_seconds = 0.0;
+    double cache_seconds = 0.0;
+    for (const char* filepath : filepaths)
+    {
+        if (TextureCache::load(filepath).width == 0)
+        {
+            std::cout << "unable to load " << filepath << std::endl;
+            return 1;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iteration_count; i++) TextureCache::decode_png(filepath);
+        std::chrono::steady_clock::time_point decoded = std::chrono::steady_clock::now();
+
+        // touch every page, since a mapping is only read when the pixels are
+        volatile int checksum = 0;
+        for (int i = 0; i < iteration_count; i++)
+        {
+            DecodedImage image = TextureCache::load(filepath);
+            for (int j = 0; j < image.get_byte_count(); j += 4096) checksum = checksum + image.get_pixels()[j];
+        }
+        std::chrono::steady_clock::time_point cached = std::chrono::steady_clock::now();
+
+        double png_ms = std::chrono::duration<double>(decoded - start).count() * 1000.0 / iteration_count;
+        double cache_ms = std::chrono::duration<double>(cached - decoded).count() * 1000.0 / iteration_count;
+        png_seconds += png_ms / 1000.0;
+        cache_seconds += cache_ms / 1000.0;
+
+        std::cout << filepath << ": png " << png_ms << " ms, cache " << cache_ms << " ms" << std::endl;
+    }
+
+    std::cout << "all textures: png " << png_seconds * 1000.0 << " ms, cache " << cache_seconds * 1000.0 << " ms" << std::endl;
+
+    return 0;
+}
+
+/*
+* Packs assets into one file for AssetPack to map
+* usage: HW5 --build-pack [output.pack] [files...]
+* With no files given, packs every texture, shader, sound and level that ships with the game
+* (the scenes' music isn't in the tree, so it is read loose if it is there)
+* Nothing is written if any of the files can't be read
+*/
+int run_pack_builder(int argc, char* argv[])
+{
+    std::string pack_filepath = argc > 2 ? argv[2] : ASSET_PACK_FILEPATH;
+
+    std::vector<std::string> names(argv + std::min(argc, 3), argv + argc);
+    if (names.empty())
+    {
+        names = {
+            "tileset.png", "Player.png", "Chain.png", "Door.png", "Enemy.png", "font.png",
+            V_SHADER_PATH, F_SHADER_PATH, V_TILE_ARRAY_SHADER_PATH, F_TILE_ARRAY_SHADER_PATH,
+            V_TILEMAP_SHADER_PATH, F_TILEMAP_SHADER_PATH, V_LIGHT_SHADER_PATH, F_LIGHT_SHADER_PATH,
+            "player_jump.wav", "chain_throw.wav",
+            "levels/menu.lvl", "levels/level1.lvl", "levels/level2.lvl", "levels/level3.lvl", "levels/won.lvl", "levels/lost.lvl"
+        };
+    }
+
+    if (!AssetPack::build(pack_filepath, names)) return 1;
+
+    AssetPack pack;
+    if (!pack.open(pack_filepath))
+    {
+        std::cout << "unable to read back " << pack_filepath << std::endl;
+        return 1;
+    }
+    std::cout << pack_filepath << ": " << pack.get_entry_count() << " assets, " << pack.get_file()->get_size() << " bytes" << std::endl;
+
+    return 0;
+}
+
+/*
+* Compiles a level made in Tiled (.tmx or .json) or written as CSV into a level file
+* usage: HW5 --compile-level source [output.lvl]
+* The output goes next to the source, with a .lvl extension, if no path is given
+*/
+int run_level_compiler(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "usage: HW5 --compile-level source [output.lvl]" << std::endl;
+        return 1;
+    }
+
+    std::string source_filepath = argv[2];
+    std::string level_filepath = argc > 3 ? argv[3] : source_filepath.substr(0, source_filepath.find_last_of('.')) + ".lvl";
+
+    return LevelCompiler::compile(source_filepath, level_filepath) ? 0 : 1;
+}
+
+/*
+* Checks every scene's level file and built-in copy against the CSV next to
+* the level file, which both were made from
+* usage: HW5 --check-levels
+*
+* @return 0 if every level matched, 1 otherwise
+*/
+int run_level_check(int argc, char* argv[])
+{
+    // only asked for their levels, never initialised
+    Scene* scenes[] = { new MainMenu(), new Level1(), new Level2(), new Level3(), new Won(), new Lost() };
+
+    int failures = 0;
+    for (Scene* scene : scenes)
+    {
+        std::string level_filepath = scene->get_level_filepath();
+        std::string source_filepath = level_filepath.substr(0, level_filepath.find_last_of('.')) + ".csv";
+        if (!LevelCompiler::check(source_filepath, level_filepath, scene->get_embedded_level())) failures++;
+    }
+
+    std::cout << (failures == 0 ? "level check passed" : "level check FAILED") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
+
 //  GAME LOOP  //
 int main(int argc, char* argv[])
 {
+    if (argc > 1 && std::string(argv[1]) == "--bench") return run_benchmark(argc, argv);
+    if (argc > 1 && std::string(argv[1]) == "--bench-lights")
+    {
+        g_lighting_enabled = true;
+        return run_benchmark(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--check-render") return run_render_check(argc, argv);
+    if (argc > 1 && std::string(argv[1]) == "--check-map-modes") return run_map_mode_check(argc, argv);
+    if (argc > 1 && std::string(argv[1]) == "--bench-particles") return run_particle_benchmark(argc, argv);
+    if (argc > 1 && std::string(argv[1]) == "--bench-textures") return run_texture_benchmark(argc, argv);
+    if (argc > 1 && std::string(argv[1]) == "--bench-collision") return run_collision_benchmark(argc, argv);
+    if (argc > 1 && std::string(argv[1]) == "--bench-entities") return run_entity_benchmark(argc, argv);
+    if (argc > 1 && std::string(argv[1]) == "--build-pack") return run_pack_builder(argc, argv);
+    if (argc > 1 && std::string(argv[1]) == "--check-levels") return run_level_check(argc, argv);
+    if (argc > 1 && std::string(argv[1]) == "--compile-level") return run_level_compiler(argc, argv);
+
     initialise();
 
     while (g_game_is_running)
@@ -0,0 +1,11 @@
+uniform vec4 color; // rgb, and the intensity in a
+uniform vec2 lightPosition;
+uniform float lightRadius;
+
+varying vec2 worldPosition;
+
+void main() {
+    // quadratic falloff, reaching 0 at the radius
+    float falloff = clamp(1.0 - length(worldPosition - lightPosition) / lightRadius, 0.0, 1.0);
+    gl_FragColor = vec4(color.rgb * color.a * falloff * falloff, 1.0);
+}
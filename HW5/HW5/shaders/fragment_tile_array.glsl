@@ -0,0 +1,8 @@
+#extension GL_EXT_texture_array : enable
+
+uniform sampler2DArray diffuse;
+varying vec3 texCoordVar;
+
+void main() {
+    gl_FragColor = texture2DArray(diffuse, texCoordVar);
+}
@@ -0,0 +1,26 @@
+uniform sampler2D diffuse;
+uniform sampler2D tileIndices;
+uniform sampler2D tileAnimations; // one texel per tile set tile -- frame count, quarter frames per second
+
+uniform vec2 mapSize;
+uniform vec2 tileCount;
+uniform float time;
+
+varying vec2 tilePosition;
+
+void main() {
+    vec2 tile = floor(tilePosition);
+    float id = floor(texture2D(tileIndices, (tile + 0.5) / mapSize).r * 255.0 + 0.5);
+
+    // EMPTY TILES/AIR ARE DENOTED AS 0
+    if (id < 0.5) discard;
+
+    // animated tiles step through the tiles after their own, wrapping past the last one
+    float tile_set_size = tileCount.x * tileCount.y;
+    id = mod(id, tile_set_size);
+    vec2 animation = floor(texture2D(tileAnimations, vec2((id + 0.5) / tile_set_size, 0.5)).ra * 255.0 + 0.5);
+    id = mod(id + mod(floor(time * animation.y / 4.0), max(animation.x, 1.0)), tile_set_size);
+
+    vec2 tile_set_position = vec2(mod(id, tileCount.x), floor(id / tileCount.x));
+    gl_FragColor = texture2D(diffuse, (tile_set_position + fract(tilePosition)) / tileCount);
+}
\ No newline at end of file
@@ -1,11 +1,13 @@
 attribute vec4 position;
 
-uniform mat4 modelMatrix;
+uniform vec4 modelLinear; // 2x2, column major
+uniform vec2 modelTranslation;
 uniform mat4 viewMatrix;
 uniform mat4 projectionMatrix;
 
 void main()
 {
-	vec4 p = viewMatrix * modelMatrix  * position;
+	vec2 world = mat2(modelLinear.xy, modelLinear.zw) * position.xy + modelTranslation;
+	vec4 p = viewMatrix * vec4(world, 0.0, 1.0);
 	gl_Position = projectionMatrix * p;
 }
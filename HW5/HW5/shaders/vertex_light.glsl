@@ -0,0 +1,16 @@
+attribute vec4 position;
+
+uniform vec4 modelLinear; // 2x2, column major
+uniform vec2 modelTranslation;
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+
+varying vec2 worldPosition;
+
+void main()
+{
+	vec2 world = mat2(modelLinear.xy, modelLinear.zw) * position.xy + modelTranslation;
+	vec4 p = viewMatrix * vec4(world, 0.0, 1.0);
+	worldPosition = world;
+	gl_Position = projectionMatrix * p;
+}
@@ -1,7 +1,8 @@
 attribute vec4 position;
 attribute vec2 texCoord;
 
-uniform mat4 modelMatrix;
+uniform vec4 modelLinear; // 2x2, column major
+uniform vec2 modelTranslation;
 uniform mat4 viewMatrix;
 uniform mat4 projectionMatrix;
 
@@ -9,7 +10,8 @@ varying vec2 texCoordVar;
 
 void main()
 {
-	vec4 p = viewMatrix * modelMatrix  * position;
-    texCoordVar = texCoord;
+	vec2 world = mat2(modelLinear.xy, modelLinear.zw) * position.xy + modelTranslation;
+	vec4 p = viewMatrix * vec4(world, 0.0, 1.0);
+	texCoordVar = texCoord;
 	gl_Position = projectionMatrix * p;
 }
\ No newline at end of file
@@ -0,0 +1,23 @@
+attribute vec4 position;
+attribute float layer;
+attribute vec2 animation; // frame count, quarter frames per second (TILE_FRAME_RATE_STEPS)
+
+uniform vec4 modelLinear; // 2x2, column major
+uniform vec2 modelTranslation;
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+uniform float time;
+uniform float layerCount;
+
+varying vec3 texCoordVar;
+
+void main()
+{
+	vec2 world = mat2(modelLinear.xy, modelLinear.zw) * position.xy + modelTranslation;
+	vec4 p = viewMatrix * vec4(world, 0.0, 1.0);
+	// position is in whole tiles, so a merged quad repeats the tile once per tile it covers
+	// animated tiles step through the layers after their own, wrapping past the last one
+	float frame = mod(floor(time * animation.y / 4.0), max(animation.x, 1.0));
+	texCoordVar = vec3(position.x, -position.y, mod(layer + frame, layerCount));
+	gl_Position = projectionMatrix * p;
+}
\ No newline at end of file
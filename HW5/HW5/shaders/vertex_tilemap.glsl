@@ -0,0 +1,17 @@
+attribute vec4 position;
+
+uniform vec4 modelLinear; // 2x2, column major
+uniform vec2 modelTranslation;
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+
+varying vec2 tilePosition;
+
+void main()
+{
+	vec2 world = mat2(modelLinear.xy, modelLinear.zw) * position.xy + modelTranslation;
+	vec4 p = viewMatrix * vec4(world, 0.0, 1.0);
+	// position is in tiles, y goes down the level array
+	tilePosition = vec2(position.x, -position.y);
+	gl_Position = projectionMatrix * p;
+}
\ No newline at end of file